@@ -0,0 +1,310 @@
+// gsalt_bench: end-to-end benchmark of gsalt on procedural meshes
+//
+// Every mesh is run through every strategy and attribute combination,
+// timing is reported as JSON (one object per run).
+//
+// usage: gsalt_bench [-s sizes] [-m meshes] [-S strategies] [-a attributes] [-r ratio] [-o file.json]
+//   sizes       comma separated triangles counts (default 10000,100000,1000000)
+//   meshes      sphere,terrain,soup,seams (default all)
+//   strategies  prop,edge,face,he (default all)
+//   attributes  comma separated subsets of n,c,t, or "none" / "all" (default all the combinations)
+//   ratio       objective, as a fraction of the input triangles (default 0.25)
+//   file.json   where to write the results (default gsalt_bench.json)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <gsalt/gsalt.h>
+#include "../src/gsalt_timer.h"
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+struct Mesh {
+	std::vector<float> pos;		// 3 per vertex
+	std::vector<float> nrm;		// 3 per vertex
+	std::vector<float> col;		// 4 per vertex
+	std::vector<float> uv;		// 2 per vertex
+	std::vector<uint32_t> idx;	// 3 per triangle
+
+	int num_vertex() const { return (int)(pos.size()/3); }
+	int num_triangles() const { return (int)(idx.size()/3); }
+
+	void add_vertex(float x, float y, float z, float nx, float ny, float nz, float s, float t) {
+		pos.push_back(x); pos.push_back(y); pos.push_back(z);
+		nrm.push_back(nx); nrm.push_back(ny); nrm.push_back(nz);
+		col.push_back(0.5f+0.5f*nx); col.push_back(0.5f+0.5f*ny); col.push_back(0.5f+0.5f*nz); col.push_back(1.0f);
+		uv.push_back(s); uv.push_back(t);
+	}
+	void add_triangle(uint32_t a, uint32_t b, uint32_t c) {
+		idx.push_back(a); idx.push_back(b); idx.push_back(c);
+	}
+};
+
+static uint32_t rng_state = 0x12345678;
+static float frand() {
+	rng_state ^= rng_state<<13; rng_state ^= rng_state>>17; rng_state ^= rng_state<<5;
+	return (float)(rng_state&0xffffff)/(float)0x1000000;
+}
+
+static float terrain_height(float x, float y) {
+	return 0.15f*sinf(x*7.1f)*cosf(y*5.3f) + 0.05f*sinf(x*23.0f+y*17.0f);
+}
+
+// icosahedron, subdivided until it reaches the triangle count
+static void gen_sphere(Mesh& m, int triangles) {
+	const float t = (1.0f+sqrtf(5.0f))/2.0f;
+	const float v[12][3] = {{-1,t,0},{1,t,0},{-1,-t,0},{1,-t,0},{0,-1,t},{0,1,t},{0,-1,-t},{0,1,-t},{t,0,-1},{t,0,1},{-t,0,-1},{-t,0,1}};
+	const uint32_t f[20][3] = {{0,11,5},{0,5,1},{0,1,7},{0,7,10},{0,10,11},{1,5,9},{5,11,4},{11,10,2},{10,7,6},{7,1,8},
+		{3,9,4},{3,4,2},{3,2,6},{3,6,8},{3,8,9},{4,9,5},{2,4,11},{6,2,10},{8,6,7},{9,8,1}};
+	std::vector<float> p;
+	for (int i=0; i<12; i++) {
+		float l = sqrtf(v[i][0]*v[i][0]+v[i][1]*v[i][1]+v[i][2]*v[i][2]);
+		for (int k=0; k<3; k++) p.push_back(v[i][k]/l);
+	}
+	std::vector<uint32_t> idx(&f[0][0], &f[0][0]+60);
+	while ((int)idx.size()/3*4 <= triangles) {
+		std::unordered_map<uint64_t, uint32_t> mid;
+		std::vector<uint32_t> next;
+		next.reserve(idx.size()*4);
+		for (size_t i=0; i<idx.size(); i+=3) {
+			uint32_t m3[3];
+			for (int e=0; e<3; e++) {
+				uint32_t a = idx[i+e], b = idx[i+(e+1)%3];
+				uint64_t key = (a<b)?((uint64_t)a<<32|b):((uint64_t)b<<32|a);
+				std::unordered_map<uint64_t, uint32_t>::iterator it = mid.find(key);
+				if (it==mid.end()) {
+					float x = p[a*3]+p[b*3], y = p[a*3+1]+p[b*3+1], z = p[a*3+2]+p[b*3+2];
+					float l = sqrtf(x*x+y*y+z*z);
+					m3[e] = (uint32_t)(p.size()/3);
+					p.push_back(x/l); p.push_back(y/l); p.push_back(z/l);
+					mid[key] = m3[e];
+				} else
+					m3[e] = it->second;
+			}
+			uint32_t a = idx[i], b = idx[i+1], c = idx[i+2];
+			uint32_t n[12] = {a,m3[0],m3[2], b,m3[1],m3[0], c,m3[2],m3[1], m3[0],m3[1],m3[2]};
+			next.insert(next.end(), n, n+12);
+		}
+		idx.swap(next);
+	}
+	for (size_t i=0; i<p.size(); i+=3)
+		m.add_vertex(p[i], p[i+1], p[i+2], p[i], p[i+1], p[i+2], atan2f(p[i+2], p[i])*0.159155f+0.5f, p[i+1]*0.5f+0.5f);
+	m.idx.swap(idx);
+}
+
+// height field with some noise
+static void gen_terrain(Mesh& m, int triangles) {
+	int n = (int)sqrtf(triangles/2.0f);
+	if (n<1) n = 1;
+	float h = 1.0f/n;
+	for (int j=0; j<=n; j++)
+		for (int i=0; i<=n; i++) {
+			float x = i*h, y = j*h;
+			float z = terrain_height(x, y) + 0.002f*(frand()-0.5f);
+			float dx = (terrain_height(x+h, y)-terrain_height(x-h, y))/(2*h);
+			float dy = (terrain_height(x, y+h)-terrain_height(x, y-h))/(2*h);
+			float l = sqrtf(dx*dx+dy*dy+1.0f);
+			m.add_vertex(x, y, z, -dx/l, -dy/l, 1.0f/l, x, y);
+		}
+	for (int j=0; j<n; j++)
+		for (int i=0; i<n; i++) {
+			uint32_t a = j*(n+1)+i, b = a+1, c = a+n+1, d = c+1;
+			m.add_triangle(a, b, d);
+			m.add_triangle(a, d, c);
+		}
+}
+
+// unconnected triangles
+static void gen_soup(Mesh& m, int triangles) {
+	for (int i=0; i<triangles; i++) {
+		float x = frand(), y = frand(), z = frand();
+		uint32_t base = m.num_vertex();
+		for (int k=0; k<3; k++)
+			m.add_vertex(x+0.01f*frand(), y+0.01f*frand(), z+0.01f*frand(), 0, 0, 1, frand(), frand());
+		m.add_triangle(base, base+1, base+2);
+	}
+}
+
+// terrain cut in 32x32 charts: vertex on the chart borders are duplicated with their own texcoord
+static void gen_seams(Mesh& m, int triangles) {
+	const int chart = 32;
+	int n = (int)sqrtf(triangles/2.0f);
+	n = ((n+chart/2)/chart)*chart;
+	if (n<chart) n = chart;
+	float h = 1.0f/n;
+	for (int cj=0; cj<n; cj+=chart)
+		for (int ci=0; ci<n; ci+=chart) {
+			uint32_t base = m.num_vertex();
+			for (int j=0; j<=chart; j++)
+				for (int i=0; i<=chart; i++) {
+					float x = (ci+i)*h, y = (cj+j)*h;
+					m.add_vertex(x, y, terrain_height(x, y), 0, 0, 1, (float)i/chart, (float)j/chart);
+				}
+			for (int j=0; j<chart; j++)
+				for (int i=0; i<chart; i++) {
+					uint32_t a = base+j*(chart+1)+i, b = a+1, c = a+chart+1, d = c+1;
+					m.add_triangle(a, b, d);
+					m.add_triangle(a, d, c);
+				}
+		}
+}
+
+static const struct { const char* name; void (*gen)(Mesh&, int); } meshes[] = {
+	{"sphere", gen_sphere}, {"terrain", gen_terrain}, {"soup", gen_soup}, {"seams", gen_seams}
+};
+static const struct { const char* name; unsigned int flag; } strategies[] = {
+	{"prop", GSALT_PROP}, {"edge", GSALT_EDGE}, {"face", GSALT_FACE}, {"he", GSALT_HALFEDGE}
+};
+
+// Peak resident set size, in KB (reset between runs when the kernel allows it)
+static void reset_peak_rss() {
+	FILE* f = fopen("/proc/self/clear_refs", "w");
+	if (f) {
+		fputs("5", f);
+		fclose(f);
+	}
+}
+static long peak_rss() {
+	FILE* f = fopen("/proc/self/status", "r");
+	if (f) {
+		char line[256];
+		long kb = -1;
+		while (fgets(line, sizeof(line), f))
+			if (!strncmp(line, "VmHWM:", 6))
+				kb = atol(line+6);
+		fclose(f);
+		if (kb>=0)
+			return kb;
+	}
+#ifndef _WIN32
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+#else
+	return -1;
+#endif
+}
+
+static bool in_list(const char* list, const char* name) {
+	if (!list)
+		return true;
+	size_t l = strlen(name);
+	for (const char* p = list; p && *p; p = strchr(p, ',')?strchr(p, ',')+1:NULL)
+		if (!strncmp(p, name, l) && (p[l]==',' || p[l]=='\0'))
+			return true;
+	return false;
+}
+
+static std::string attrib_name(unsigned int flags) {
+	std::string s;
+	if (flags&GSALT_NORMAL) s += "n";
+	if (flags&GSALT_COLOR) s += "c";
+	if (flags&GSALT_TEXCOORD) s += "t";
+	return s.empty()?"none":s;
+}
+
+int main(int argc, char** argv) {
+	const char* sizes = "10000,100000,1000000";
+	const char* mesh_list = NULL;
+	const char* strategy_list = NULL;
+	const char* attrib_list = NULL;
+	const char* output = "gsalt_bench.json";
+	float ratio = 0.25f;
+
+	for (int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-s") && i+1<argc) sizes = argv[++i];
+		else if (!strcmp(argv[i], "-m") && i+1<argc) mesh_list = argv[++i];
+		else if (!strcmp(argv[i], "-S") && i+1<argc) strategy_list = argv[++i];
+		else if (!strcmp(argv[i], "-a") && i+1<argc) attrib_list = argv[++i];
+		else if (!strcmp(argv[i], "-r") && i+1<argc) ratio = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-o") && i+1<argc) output = argv[++i];
+		else {
+			fprintf(stderr, "usage: %s [-s sizes] [-m meshes] [-S strategies] [-a attributes] [-r ratio] [-o file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (attrib_list && !strcmp(attrib_list, "all"))
+		attrib_list = NULL;
+
+	// the library banner and logs go to stdout, so the JSON goes to its own file
+	gsalt_init();
+	gsalt_set_verbose(gsalt_verbose_error);
+	FILE* json = fopen(output, "w");
+	if (!json) {
+		fprintf(stderr, "cannot open %s\n", output);
+		return 1;
+	}
+	fprintf(json, "[\n");
+	int first = 1;
+
+	for (const char* sz = sizes; sz && *sz; sz = strchr(sz, ',')?strchr(sz, ',')+1:NULL) {
+		int size = atoi(sz);
+		for (size_t mi=0; mi<sizeof(meshes)/sizeof(meshes[0]); mi++) {
+			if (!in_list(mesh_list, meshes[mi].name))
+				continue;
+			Mesh mesh;
+			rng_state = 0x12345678;
+			meshes[mi].gen(mesh, size);
+			for (size_t si=0; si<sizeof(strategies)/sizeof(strategies[0]); si++) {
+				if (!in_list(strategy_list, strategies[si].name))
+					continue;
+				for (unsigned int attr=0; attr<8; attr++) {
+					unsigned int attribs = ((attr&1)?GSALT_NORMAL:0) | ((attr&2)?GSALT_COLOR:0) | ((attr&4)?GSALT_TEXCOORD:0);
+					std::string aname = attrib_name(attribs);
+					if (!in_list(attrib_list, aname.c_str()))
+						continue;
+					unsigned int flags = GSALT_VERTEX | strategies[si].flag | attribs;
+
+					// gsalt writes the result back in the arrays, so work on a copy
+					Mesh work = mesh;
+					int nv = work.num_vertex(), nt = work.num_triangles();
+					int objective = (int)(nt*ratio);
+					if (objective<3) objective = 3;
+
+					reset_peak_rss();
+					double t0 = gsalt_time();
+					GSalt gsalt = gsalt_new(nv, nt, flags);
+					gsalt_array_vertex(gsalt, GSALT_FLOAT, 3, 0, &work.pos[0]);
+					if (attribs&GSALT_NORMAL) gsalt_array_normal(gsalt, GSALT_FLOAT, 0, &work.nrm[0]);
+					if (attribs&GSALT_COLOR) gsalt_array_color(gsalt, GSALT_FLOAT, 4, 0, &work.col[0]);
+					if (attribs&GSALT_TEXCOORD) gsalt_array_texcoord(gsalt, GSALT_FLOAT, 2, 0, &work.uv[0]);
+					gsalt_array_indexes(gsalt, GSALT_UINT32, &work.idx[0]);
+					double t1 = gsalt_time();
+					int result = gsalt_simplify(gsalt, objective);
+					double t2 = gsalt_time();
+					gsalt_stats stats;
+					gsalt_query_stats(gsalt, &stats);
+					int result_vertex = gsalt_query_numvertex(gsalt);
+					gsalt_delete(gsalt);
+					long rss = peak_rss();
+
+					fprintf(json, "%s  {\"mesh\": \"%s\", \"vertices\": %d, \"triangles\": %d, \"strategy\": \"%s\", \"attributes\": \"%s\", "
+						"\"objective\": %d, \"result_triangles\": %d, \"result_vertices\": %d, "
+						"\"ingest_s\": %.6f, \"initialize_s\": %.6f, \"quadrics_s\": %.6f, \"boundaries_s\": %.6f, \"edges_s\": %.6f, "
+						"\"decimate_s\": %.6f, \"output_s\": %.6f, \"simplify_s\": %.6f, "
+						"\"heap_extracts\": %u, \"stale_extracts\": %u, \"rejected_extracts\": %u, \"recomputations\": %u, \"optimize_fallbacks\": %u, "
+						"\"triangles_per_s\": %.1f, \"peak_bytes\": %llu, \"peak_rss_kb\": %ld}",
+						first?"":",\n", meshes[mi].name, nv, nt, strategies[si].name, aname.c_str(),
+						objective, result, result_vertex,
+						t1-t0, stats.time_initialize, stats.time_collect_quadrics, stats.time_constrain_boundaries, stats.time_collect_edges,
+						stats.time_decimate, stats.time_output, t2-t1,
+						stats.heap_extracts, stats.stale_extracts, stats.rejected_extracts, stats.recomputations, stats.optimize_fallbacks,
+						(t2>t0)?nt/(t2-t0):0.0, (unsigned long long)stats.peak_bytes, rss);
+					fflush(json);
+					first = 0;
+					printf("%-8s %9d tris  %-4s %-4s  %8.3fs  %12.0f tris/s\n", meshes[mi].name, nt, strategies[si].name, aname.c_str(),
+						t2-t0, (t2>t0)?nt/(t2-t0):0.0);
+					fflush(stdout);
+				}
+			}
+		}
+	}
+	fprintf(json, "\n]\n");
+	fclose(json);
+	return 0;
+}
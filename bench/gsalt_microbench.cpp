@@ -0,0 +1,286 @@
+// gsalt_microbench: micro-benchmarks of the qslim primitives
+//
+// When the gsalt_bench numbers move, this tells which primitive moved.
+// Results are printed as a table and written as JSON (one object per benchmark).
+//
+// usage: gsalt_microbench [-f filter] [-o file.json]
+//   filter      only run the benchmark groups matching this string (heap, quadric3, quadric_d8, contraction, ...)
+//   file.json   where to write the results (default gsalt_microbench.json)
+
+#include "qslim/stdmix.h"
+#include "qslim/MxHeap.h"
+#include "qslim/MxQMetric3.h"
+#include "qslim/MxQMetric.h"
+#include "qslim/MxStdModel.h"
+#include "../src/gsalt_timer.h"
+
+static const char* filter = NULL;
+static FILE* json = NULL;
+static int first = 1;
+static volatile real sink;
+
+static uint32_t rng_state = 0x12345678;
+static float frand() {
+	rng_state ^= rng_state<<13; rng_state ^= rng_state>>17; rng_state ^= rng_state<<5;
+	return (float)(rng_state&0xffffff)/(float)0x1000000;
+}
+
+static bool enabled(const char* group) {
+	return !filter || strstr(group, filter) || strstr(filter, group);
+}
+
+static void report(const char* name, int size, int ops, double seconds) {
+	double ns = (ops>0)?seconds*1e9/ops:0.0;
+	printf("%-36s %9d %10d ops %10.1f ns/op\n", name, size, ops, ns);
+	fflush(stdout);
+	fprintf(json, "%s  {\"name\": \"%s\", \"size\": %d, \"ops\": %d, \"seconds\": %.6f, \"ns_per_op\": %.2f}",
+		first?"":",\n", name, size, ops, seconds, ns);
+	first = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// MxHeap
+
+static void bench_heap(int n) {
+	MxHeapable* items = new MxHeapable[n];
+	MxHeap heap;
+	double t;
+
+	t = gsalt_time();
+	for (int i=0; i<n; i++)
+		heap.insert(&items[i], frand());
+	report("heap_insert", n, n, gsalt_time()-t);
+
+	t = gsalt_time();
+	for (int i=0; i<n; i++)
+		heap.update(&items[(int)(((long long)i*7919)%n)], frand());
+	report("heap_update", n, n, gsalt_time()-t);
+
+	t = gsalt_time();
+	for (int i=0; i<n; i+=2)
+		heap.remove(&items[(int)(((long long)i*7919)%n)]);
+	report("heap_remove", n, (n+1)/2, gsalt_time()-t);
+
+	int extracted = 0;
+	t = gsalt_time();
+	while (heap.extract())
+		extracted++;
+	report("heap_extract", n, extracted, gsalt_time()-t);
+
+	delete[] items;
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// MxQuadric3 and MxQuadric
+
+static void bench_quadric3(int n) {
+	MxQuadric3* q = new MxQuadric3[n];
+	for (int i=0; i<n; i++) {
+		Vec3 nrm(frand()-0.5f, frand()-0.5f, frand()-0.5f);
+		unitize(nrm);
+		q[i] = MxQuadric3(nrm[0], nrm[1], nrm[2], frand(), frand());
+	}
+	MxQuadric3 acc;
+	double t;
+
+	t = gsalt_time();
+	for (int i=0; i<n; i++)
+		acc += q[i];
+	report("quadric3_add", n, n, gsalt_time()-t);
+
+	real e = 0.0;
+	t = gsalt_time();
+	for (int i=0; i<n; i++)
+		e += q[i].evaluate(frand(), frand(), frand());
+	report("quadric3_evaluate", n, n, gsalt_time()-t);
+	sink = e;
+
+	float x, y, z;
+	int ok = 0;
+	t = gsalt_time();
+	for (int i=0; i+2<n; i++) {
+		MxQuadric3 Q = q[i];
+		Q += q[i+1];
+		Q += q[i+2];
+		ok += Q.optimize(&x, &y, &z);
+	}
+	report("quadric3_optimize", n, n-2, gsalt_time()-t);
+	sink = ok;
+
+	delete[] q;
+}
+
+static void bench_quadric(int dim, int n) {
+	char name[64];
+	MxVector p1(dim), p2(dim), p3(dim), v(dim);
+	MxQuadric acc(dim);
+	MxQuadric** q = new MxQuadric*[n];
+	for (int i=0; i<n; i++) {
+		for (int k=0; k<dim; k++) {
+			p1[k] = frand(); p2[k] = frand(); p3[k] = frand();
+		}
+		q[i] = new MxQuadric(p1, p2, p3, frand());
+	}
+	double t;
+
+	t = gsalt_time();
+	for (int i=0; i<n; i++)
+		acc += *q[i];
+	sprintf(name, "quadric_d%d_add", dim);
+	report(name, n, n, gsalt_time()-t);
+
+	real e = 0.0;
+	t = gsalt_time();
+	for (int i=0; i<n; i++) {
+		v[i%dim] = frand();
+		e += q[i]->evaluate(v);
+	}
+	sprintf(name, "quadric_d%d_evaluate", dim);
+	report(name, n, n, gsalt_time()-t);
+	sink = e;
+
+	int ok = 0;
+	t = gsalt_time();
+	for (int i=0; i+2<n; i++) {
+		MxQuadric Q(*q[i]);
+		Q += *q[i+1];
+		Q += *q[i+2];
+		ok += Q.optimize(v);
+	}
+	sprintf(name, "quadric_d%d_optimize", dim);
+	report(name, n, n-2, gsalt_time()-t);
+	sink = ok;
+
+	for (int i=0; i<n; i++)
+		delete q[i];
+	delete[] q;
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// MxStdModel
+
+static MxStdModel* make_grid(int n) {
+	MxStdModel* m = new MxStdModel((n+1)*(n+1), n*n*2);
+	for (int j=0; j<=n; j++)
+		for (int i=0; i<=n; i++)
+			m->add_vertex((float)i, (float)j, 0.1f*frand());
+	for (int j=0; j<n; j++)
+		for (int i=0; i<n; i++) {
+			uint a = j*(n+1)+i, b = a+1, c = a+n+1, d = c+1;
+			m->add_face(a, b, d);
+			m->add_face(a, d, c);
+		}
+	return m;
+}
+
+static void bench_model(int n) {
+	MxStdModel* m = make_grid(n);
+	int nv = m->vert_count();
+	double t;
+
+	MxVertexList star;
+	int total = 0;
+	t = gsalt_time();
+	for (int v=0; v<nv; v++) {
+		star.reset();
+		m->collect_vertex_star(v, star);
+		total += star.length();
+	}
+	report("collect_vertex_star", nv, nv, gsalt_time()-t);
+	sink = total;
+
+	// contract every other edge along the rows, they are independent
+	int count = 0;
+	for (int j=0; j<=n; j++)
+		for (int i=0; i+1<=n; i+=2)
+			count++;
+	MxPairContraction* conx = new MxPairContraction[count];
+	float vnew[3];
+	t = gsalt_time();
+	int k = 0;
+	for (int j=0; j<=n; j++)
+		for (int i=0; i+1<=n; i+=2) {
+			uint v1 = j*(n+1)+i;
+			vnew[0] = i+0.5f; vnew[1] = (float)j; vnew[2] = 0.0f;
+			m->compute_contraction(v1, v1+1, &conx[k++], vnew);
+		}
+	report("compute_contraction", nv, count, gsalt_time()-t);
+
+	t = gsalt_time();
+	for (int i=0; i<count; i++)
+		m->apply_contraction(conx[i]);
+	report("apply_contraction", nv, count, gsalt_time()-t);
+
+	delete[] conx;
+	delete m;
+}
+
+////////////////////////////////////////////////////////////////////////
+//
+// MxDynBlock
+
+static void bench_dynblock(int n) {
+	double t;
+
+	MxDynBlock<uint> big;
+	t = gsalt_time();
+	for (int i=0; i<n; i++)
+		big.add(i);
+	report("dynblock_add", n, n, gsalt_time()-t);
+
+	// the pattern of the per vertex face lists: a lot of small blocks
+	int lists = n/8;
+	MxFaceList* small = new MxFaceList[lists];
+	t = gsalt_time();
+	for (int i=0; i<lists*8; i++)
+		small[i%lists].add(i);
+	report("dynblock_add_small", n, lists*8, gsalt_time()-t);
+	delete[] small;
+}
+
+int main(int argc, char** argv) {
+	const char* output = "gsalt_microbench.json";
+
+	for (int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-f") && i+1<argc) filter = argv[++i];
+		else if (!strcmp(argv[i], "-o") && i+1<argc) output = argv[++i];
+		else {
+			fprintf(stderr, "usage: %s [-f filter] [-o file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	json = fopen(output, "w");
+	if (!json) {
+		fprintf(stderr, "cannot open %s\n", output);
+		return 1;
+	}
+	fprintf(json, "[\n");
+
+	static const int heap_sizes[] = {1000, 64000, 1000000};
+	if (enabled("heap"))
+		for (int i=0; i<3; i++)
+			bench_heap(heap_sizes[i]);
+	if (enabled("quadric3"))
+		bench_quadric3(1000000);
+	// the dimensions MxPropSlim uses: position, + color, texcoord and/or normal
+	static const int dims[] = {3, 5, 6, 8, 9, 11};
+	for (int i=0; i<6; i++) {
+		char name[32];
+		sprintf(name, "quadric_d%d", dims[i]);
+		if (enabled(name))
+			bench_quadric(dims[i], 100000);
+	}
+	if (enabled("contraction") || enabled("collect_vertex_star"))
+		for (int n=100; n<=1000; n*=10)
+			bench_model(n);
+	if (enabled("dynblock"))
+		bench_dynblock(10000000);
+
+	fprintf(json, "\n]\n");
+	fclose(json);
+	return 0;
+}
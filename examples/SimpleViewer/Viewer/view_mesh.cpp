@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <vector>
 #include<GL/glut.h>
 #include <gsalt/gsalt.h>
 #include "viewer/arcball.h"                           /*  Arc Ball  Interface         */
@@ -560,39 +561,36 @@ int main( int argc, char * argv[] )
 		{
 			mesh.vertices().clear();
 			mesh.faces().clear();
+			std::vector<float> pos(new_vertex*3), uv(new_vertex*2), rgb(new_vertex*4), nrm(new_vertex*3);
+			std::vector<uint32_t> idx(new_triangles*3);
+			gsalt_query_vertices(gsalt, &pos[0], 0, 0, new_vertex);
+			if(with_uv) gsalt_query_texcoords(gsalt, &uv[0], 0, 0, new_vertex);
+			if(with_color) gsalt_query_colors(gsalt, &rgb[0], 0, 0, new_vertex);
+			if(with_normal) gsalt_query_normals(gsalt, &nrm[0], 0, 0, new_vertex);
+			gsalt_query_triangles_uint32(gsalt, &idx[0], 0, new_triangles);
 			for (int i=0; i<new_vertex; i++) {
-				float x, y, z;
 				CVertex *v = new CVertex;
 				v->m_area = 0.0;
 				v->m_id = i;
 				v->m_cnt = i;
-				gsalt_query_vertex(gsalt, i, &x, &y, &z);
-				v->m_point = CPoint(x,y,z);
-				if(with_uv) {
-					gsalt_query_texcoord(gsalt, i, &x, &y);
-					v->m_uv = CPoint2(x,y);
-				}
-				if(with_color) {
-					gsalt_query_color(gsalt, i, &x, &y, &z);
-				} else {
-					x=1.0f; y=1.0f; z=1.0f;
-				}
-				v->m_rgb = CPoint(x,y,z);
-				if(with_normal) {
-					gsalt_query_normal(gsalt, i, &x, &y, &z);
-					v->m_normal = CPoint(x,y,z);
-				}
+				v->m_point = CPoint(pos[i*3+0], pos[i*3+1], pos[i*3+2]);
+				if(with_uv)
+					v->m_uv = CPoint2(uv[i*2+0], uv[i*2+1]);
+				if(with_color)
+					v->m_rgb = CPoint(rgb[i*4+0], rgb[i*4+1], rgb[i*4+2]);
+				else
+					v->m_rgb = CPoint(1.0f, 1.0f, 1.0f);
+				if(with_normal)
+					v->m_normal = CPoint(nrm[i*3+0], nrm[i*3+1], nrm[i*3+2]);
 				mesh.vertices().push_back(v);
 			}
 			for (int i=0; i<new_triangles; i++) {
-				uint32_t a, b, c;
 				CFace *f = new CFace;
-				gsalt_query_triangle_uint32(gsalt, i, &a, &b, &c);
 				f->m_id = i;
 				f->m_area = 0.0;
-				f->m_v[0] = mesh.vertices()[a];
-				f->m_v[1] = mesh.vertices()[b];
-				f->m_v[2] = mesh.vertices()[c];
+				f->m_v[0] = mesh.vertices()[idx[i*3+0]];
+				f->m_v[1] = mesh.vertices()[idx[i*3+1]];
+				f->m_v[2] = mesh.vertices()[idx[i*3+2]];
 				mesh.faces().push_back(f);
 			}
 			compute_normal( mesh );
@@ -34,12 +34,80 @@ typedef int gslat_return;
 #define GSALT_EDGE 256
 #define GSALT_FACE 128
 
+// reorder the simplified triangles for the post-transform cache, and the vertex in first use order
+#define GSALT_OPTIMIZE_VCACHE 512
+// renumber the vertex and triangles along a Morton curve before simplifying, for memory locality
+// on meshes given in random order (scans, some exporters). The outputs keep the given order.
+#define GSALT_SPATIAL_ORDER 1024
+// edge contraction on half-edge connectivity (geometry only, like GSALT_EDGE), faster on
+// manifold meshes. Meshes it cannot hold are simplified with GSALT_EDGE instead.
+#define GSALT_HALFEDGE 2048
+
+#define GSALT_ERROR_ABSOLUTE 0
+#define GSALT_ERROR_RELATIVE 1
+
 #define GSALT_UINT32 0
 #define GSALT_UINT16 1
 #define GSALT_FLOAT 2
+#define GSALT_HALF_FLOAT 3
+#define GSALT_UNSIGNED_BYTE_NORM 4	// normalized integers: 0..255 is 0..1
+#define GSALT_BYTE_NORM 5			// -127..127 is -1..1
+#define GSALT_UNSIGNED_SHORT_NORM 6
+#define GSALT_SHORT_NORM 7
+#define GSALT_INT_2_10_10_10 8		// signed normalized x,y,z (10 bits) and w (2 bits) from the low bits, like GL_INT_2_10_10_10_REV
+
+// formats of gsalt_save_file
+#define GSALT_FILE_PLY 0	// binary, with the attributes
+#define GSALT_FILE_STL 1	// binary, positions only
+#define GSALT_FILE_OBJ 2
 
 typedef void* GSalt;
 
+// One attribute of an interleaved vertex (see gsalt_array_interleaved)
+typedef struct {
+	unsigned int attrib;	// GSALT_VERTEX, GSALT_COLOR, GSALT_NORMAL or GSALT_TEXCOORD
+	int type;				// GSALT_FLOAT, GSALT_HALF_FLOAT, ... (as gsalt_array_*)
+	int size;				// number of components
+	int offset;				// in bytes, from the start of the vertex
+} gsalt_attrib_desc;
+
+// Dequantization of gsalt_query_quantized: value = offset + scale*q, for each component
+typedef struct {
+	float position_offset[3];	// the bounding box of the simplified model
+	float position_scale[3];
+	float texcoord_offset[2];	// the range of the simplified texcoords
+	float texcoord_scale[2];
+} gsalt_quant_params;
+
+typedef void (*gsalt_log_callback)(gsalt_verbose level, const char *message, void *userdata);
+
+// Time spent (in seconds) in the phases of the last simplification, and what the decimation did
+typedef struct {
+	double time_ingest;		// in the gsalt_array_* functions
+	double time_initialize;	// the 3 below, plus setup
+	double time_collect_quadrics;
+	double time_constrain_boundaries;
+	double time_collect_edges;	// filling the heap of contraction candidates (faces with GSALT_FACE)
+	double time_decimate;
+	double time_output;		// writing back the simplified arrays
+	uint32_t heap_extracts;
+	uint32_t stale_extracts;	// candidate already gone (one of its vertex was removed)
+	uint32_t rejected_extracts;	// contraction refused (would not join faces)
+	uint32_t recomputations;	// cost of a candidate updated after a neighbour contraction
+	uint32_t optimize_fallbacks;	// optimal placement not solvable, fell back on endpoints
+	uint64_t peak_bytes;	// working memory of the model, quadrics, heap and output buffers
+	uint32_t stopped;		// GSALT_STOPPED_* if the decimation ended before the objective
+} gsalt_stats;
+
+#define GSALT_STOPPED_NONE 0
+#define GSALT_STOPPED_CALLBACK 1	// the progress callback asked to cancel
+#define GSALT_STOPPED_TIME 2		// the time budget ran out
+
+// Called every GSALT_PROGRESS_INTERVAL contractions with the current number of triangles,
+// a non zero return cancels the simplification
+typedef int (*gsalt_progress_callback)(GSalt gsalt, int triangles, void *userdata);
+#define GSALT_PROGRESS_INTERVAL 1024
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,6 +118,18 @@ gslat_return gsalt_init();
 gsalt_verbose gsalt_get_verbose();
 gsalt_verbose gsalt_set_verbose(gsalt_verbose new_level);
 
+// Send the logs to a callback instead of stdout (NULL to go back to stdout).
+// Logging threads only format the message in a lock-free ring buffer (dropped if full, never blocking),
+// the callback is called by gsalt_flush_log, on the thread calling it. Gives back the number of messages.
+// Per element logs (gsalt_verbose_all) are only compiled in with the LOG_ALL cmake option.
+gslat_return gsalt_set_log_callback(gsalt_log_callback callback, void *userdata);
+int gsalt_flush_log();
+
+// Write a Chrome trace-event file (chrome://tracing or Perfetto) of the simplification phases.
+// NULL closes the current trace. The GSALT_TRACE environment variable does the same at init.
+// It can be changed while simplifications run on other threads, their events go to the open file.
+gslat_return gsalt_set_trace_file(const char *filename);
+
 // To simplify a strucutre, here is a workflow:
 // 1. create a gsalt object with gsalt_start_simplify with number of vertex and num triangles 
 //		(only triangles are supported for now, no strip or fans, no quads)
@@ -69,10 +149,44 @@ gslat_return gsalt_add_vertex(GSalt gsalt, float x, float y, float z=0.0f, float
 gslat_return gsalt_add_triangle(GSalt gsalt, int idx1, int idx2, int idx3);
 
 int gsalt_simplify(GSalt gsalt, int objective);
+// Simplify until the next contraction would cost more than max_error (or min_triangles is reached).
+// With GSALT_ERROR_RELATIVE, max_error is relative to the bounding box diagonal (costs are squared distances,
+//  and area weighted for GSALT_FACE, GSALT_EDGE and GSALT_HALFEDGE, so they are divided by diagonal^2 or diagonal^4).
+// Gives back the effective number of triangles (or -1 if error), and the highest cost of the contractions done.
+int gsalt_simplify_error(GSalt gsalt, float max_error, int min_triangles, int mode=GSALT_ERROR_ABSOLUTE, float *achieved_error=NULL);
+
+// gsalt_simplify in slices, to spread it between frames. gsalt_simplify_begin does the setup (quadrics and
+// heap, all at once), each gsalt_simplify_step does at most max_contractions contractions and/or stops after
+// about microseconds (0 for no limit), and gives back the current number of triangles, or 0 once the
+// decimation is over. gsalt_simplify_end writes the model back like gsalt_simplify (it can be called before
+// the steps are over) and gives back the same. In between, the model can't be changed, and the time budget
+// is not used (the progress callback is).
+gslat_return gsalt_simplify_begin(GSalt gsalt, int objective);
+int gsalt_simplify_step(GSalt gsalt, int max_contractions, int microseconds);
+int gsalt_simplify_end(GSalt gsalt);
+
+// gsalt_simplify on the worker threads of the library (shared by all the GSalt objects, gsalt_set_threads
+// sets how many, 0 is one per core). gsalt_simplify_async returns at once, then the callback (if not NULL) is
+// called from a worker with what gsalt_simplify would give back, and gsalt_simplify_poll gives it too, or
+// GSALT_PENDING until then (gsalt_simplify_wait blocks for it). Until the simplification is done, the object
+// can only be polled, waited for, or deleted (that waits for it). The callback can delete the object, and
+// call gsalt_set_threads (the threads running a job then quit when it is done).
+#define GSALT_PENDING -2
+typedef void (*gsalt_simplify_callback)(GSalt gsalt, int triangles, void *userdata);
+gslat_return gsalt_simplify_async(GSalt gsalt, int objective, gsalt_simplify_callback callback, void *userdata);
+int gsalt_simplify_poll(GSalt gsalt);
+int gsalt_simplify_wait(GSalt gsalt);
+gslat_return gsalt_set_threads(int n);
 
 int gsalt_query_numvertex(GSalt gsalt);
 int gsalt_query_numtriangles(GSalt gsalt);
 
+// Cost of the contractions done by the last simplify: highest and RMS (in the unit of gsalt_simplify_error)
+gslat_return gsalt_query_error(GSalt gsalt, float *max_error, float *rms_error);
+// Bounding box (3 floats each) and bounding sphere of the simplified model (any pointer can be NULL)
+gslat_return gsalt_query_bounds(GSalt gsalt, float *bbox_min, float *bbox_max, float *center, float *radius);
+gslat_return gsalt_query_stats(GSalt gsalt, gsalt_stats *stats);
+
 gslat_return gsalt_query_color(GSalt gsalt, int index, float *r, float *g, float *b, float *a=NULL);
 gslat_return gsalt_query_normal(GSalt gsalt, int index, float *x, float *y, float *z);
 gslat_return gsalt_query_texcoord(GSalt gsalt, int index, float *s, float *t, float *r=NULL, float *q=NULL);
@@ -81,19 +195,93 @@ gslat_return gsalt_query_vertex(GSalt gsalt, int index, float *x, float *y, floa
 gslat_return gsalt_query_triangle_uint32(GSalt gsalt, int index, uint32_t *idx1, uint32_t *idx2, uint32_t *idx3);
 gslat_return gsalt_query_triangle_uint16(GSalt gsalt, int index, uint16_t *idx1, uint16_t *idx2, uint16_t *idx3);
 
+// Bulk read back: count elements starting at first, every stride floats (0 for packed).
+// vertices, normals: x,y,z  colors: r,g,b,a  texcoords: s,t. Triangles are 3 packed indexes, in either width.
+gslat_return gsalt_query_vertices(GSalt gsalt, float *dst, int stride, int first, int count);
+gslat_return gsalt_query_normals(GSalt gsalt, float *dst, int stride, int first, int count);
+gslat_return gsalt_query_colors(GSalt gsalt, float *dst, int stride, int first, int count);
+gslat_return gsalt_query_texcoords(GSalt gsalt, float *dst, int stride, int first, int count);
+gslat_return gsalt_query_triangles_uint32(GSalt gsalt, uint32_t *dst, int first, int count);
+gslat_return gsalt_query_triangles_uint16(GSalt gsalt, uint16_t *dst, int first, int count);
+
+// Quantized read back for GPU upload, after a simplify (any array can be NULL):
+// positions: 4 uint16 per vertex (x, y, z, 0) over the bounding box, normals: 2 int16 octahedral encoded,
+// texcoords: 2 uint16 over the texcoords range. params gets the scale and offset to dequantize.
+gslat_return gsalt_query_quantized(GSalt gsalt, uint16_t *positions, int16_t *normals, uint16_t *texcoords, int first, int count, gsalt_quant_params *params);
+// Index stream compressed as the zigzag delta to the previous index, in LEB128 varints.
+// Gives back the number of bytes (or -1 if error), dst can be NULL to get the size first.
+int gsalt_query_triangles_varint(GSalt gsalt, uint8_t *dst, int size);
+// Decode such a stream into count indexes (3 per triangle), gives back the bytes read (or -1 if src is too short)
+int gsalt_decode_triangles_varint(const uint8_t *src, int size, uint32_t *dst, int count);
+
 gslat_return gsalt_delete(GSalt gsalt);
 
 //v0.2 api: setting arrays instead of individual elements
-// only type==GSALT_FLOAT is supported for now.
-// Stride must be in "type" unit (meaning you put 1 instead of 4 to have 1 float) 0 mean stride automaticaly calculate
+// type is GSALT_FLOAT, GSALT_HALF_FLOAT, one of the normalized integers, or GSALT_INT_2_10_10_10 (size 3 or 4).
+// They are converted on ingest, and the simplified vertex are written back in the same type.
+// Stride must be in "type" unit (meaning you put 1 instead of 4 to have 1 float, 1 per packed 32 bits element)
+// 0 mean stride automaticaly calculate
 gslat_return gsalt_array_vertex(GSalt gsalt, int type, int size, int stride, void* pointer);
 gslat_return gsalt_array_normal(GSalt gsalt, int type, int stride, void* pointer);
 gslat_return gsalt_array_color(GSalt gsalt, int type, int size, int stride, void* pointer);
 gslat_return gsalt_array_texcoord(GSalt gsalt, int type, int size, int stride, void* pointer);
 
+// All the attributes of an interleaved vertex buffer at once (stride in bytes, like sizeof(your_vertex)).
+// Ingest reads the buffer in one pass, and the simplified vertex are written back in it in one pass
+// (bytes not described by descs are left untouched).
+gslat_return gsalt_array_interleaved(GSalt gsalt, const gsalt_attrib_desc *descs, int n, int stride, void* pointer);
+
 // Both GSALT_UINT16 and GLSALT_UINT32 are available
 gslat_return gsalt_array_indexes(GSalt gsalt, int type, void* pointer);
 
+// Load an OBJ (v, vt, vn and f with v/vt/vn corners), PLY (ascii or binary) or binary STL file
+// in a new GSalt object, ready to simplify (NULL if error). The file is mapped and parsed on several threads.
+// flags as gsalt_new, the attributes the file doesn't have are dropped. Read back with gsalt_query_*.
+GSalt gsalt_load_file(const char *filename, unsigned int flags);
+// Write the simplified model (after gsalt_simplify) straight from the output arrays, with large buffered writes
+gslat_return gsalt_save_file(GSalt gsalt, const char *filename, int format);
+
+// Out-of-core simplification of a PLY file larger than memory, to objective triangles, written in format.
+// The mesh is cut in a grid of cells that each fit in memory_budget bytes (the scratch data goes to mapped
+// temporary files), each cell is simplified with the vertex on its border locked, then the cells are merged
+// 2x2x2 and simplified again up to the whole mesh. Positions only, flags chooses the strategy (GSALT_EDGE,
+// GSALT_HALFEDGE, GSALT_FACE or none). Other formats are loaded and simplified in memory. Gives back the triangles written (or -1).
+int gsalt_simplify_file(const char *input, const char *output, int format, int objective, uint64_t memory_budget, unsigned int flags);
+
+// Tiled simplification, each step can run in its own process (or machine) sharing dir, which must exist.
+// gsalt_tile_split cuts the mesh in tiles per axis (rounded up to a power of 2, 64 at most), writes the
+// non empty ones in dir and gives back how many there are. gsalt_tile_simplify simplifies tile 0..count-1
+// to its share of objective, with the vertex it shares with other tiles locked. gsalt_tile_stitch merges
+// the simplified tiles, simplifies the bands along the seams to objective and writes output in format.
+// Positions only, flags chooses the strategy as for gsalt_simplify_file. Each gives back -1 if error.
+int gsalt_tile_split(const char *input, const char *dir, int tiles);
+int gsalt_tile_simplify(const char *dir, int tile, int objective, unsigned int flags);
+int gsalt_tile_stitch(const char *dir, const char *output, int format, int objective, unsigned int flags);
+
+// Streaming api: give the arrays a chunk at a time (for example while the rest of the file is parsed).
+// Chunks of each array come in order (first is how many were given before), with the types of gsalt_array_*.
+// The chunk is copied in the model, so the memory can be reused after the call, and the simplified
+// model is read back with gsalt_query_*. Triangles can only use vertex already given.
+gslat_return gsalt_add_vertices(GSalt gsalt, int first, int count, int type, int size, int stride, const void* pointer);
+gslat_return gsalt_add_colors(GSalt gsalt, int first, int count, int type, int size, int stride, const void* pointer);
+gslat_return gsalt_add_normals(GSalt gsalt, int first, int count, int type, int stride, const void* pointer);
+gslat_return gsalt_add_texcoords(GSalt gsalt, int first, int count, int type, int size, int stride, const void* pointer);
+gslat_return gsalt_add_triangles(GSalt gsalt, int first, int count, int type, const void* pointer);
+
+// Locked vertex are never moved nor removed by gsalt_simplify (borders to keep, attachment points,
+// hand made regions). No candidate is created between two locked vertex, so large frozen regions cost
+// nothing to the decimation, but their unlocked neighbours can still be contracted onto them.
+// gsalt_lock_vertices adds to the locked vertex, gsalt_lock_mask sets all of them from num_vertex bytes
+// (non zero is locked), NULL unlocks everything.
+gslat_return gsalt_lock_vertices(GSalt gsalt, const uint32_t *ids, int n);
+gslat_return gsalt_lock_mask(GSalt gsalt, const unsigned char *mask);
+
+// A cancelled or out of time gsalt_simplify still gives a valid model, simplified as far as it went
+// (see gsalt_stats.stopped). The time budget (in seconds, 0 for none) counts from the start of
+// gsalt_simplify, but the setup before the decimation always runs to the end.
+gslat_return gsalt_set_progress_callback(GSalt gsalt, gsalt_progress_callback callback, void *userdata);
+gslat_return gsalt_set_time_budget(GSalt gsalt, double seconds);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,21 +4,31 @@
 #include <gsalt/gsalt.h>
 #include "qslim/MxQSlim.h"
 #include "qslim/MxPropSlim.h"
+#include "gsalt_vcache.h"
+#include "gsalt_order.h"
+#include "gsalt_timer.h"
+#include "gsalt_trace.h"
+#include "gsalt_logring.h"
+#include "gsalt_convert.h"
+#include "gsalt_writer.h"
+#include "gsalt_pool.h"
 
 
 gsalt_verbose verbose_level = gsalt_verbose_warning;
 char const* verbose_string[] = {"None", "Error", "Warning", "Debug", "All"};
 
-#define GSALT_ALLFLAGS GSALT_VERTEX|GSALT_COLOR|GSALT_NORMAL|GSALT_TEXCOORD|GSALT_EDGE|GSALT_FACE
+#define GSALT_ALLFLAGS GSALT_VERTEX|GSALT_COLOR|GSALT_NORMAL|GSALT_TEXCOORD|GSALT_EDGE|GSALT_FACE|GSALT_OPTIMIZE_VCACHE|GSALT_SPATIAL_ORDER|GSALT_HALFEDGE
 
 
 int gsalt_inited = 0;
 
 typedef struct {
-	float* ptr;
+	char* ptr;
+	int type;
 	int size;
-	int stride;
+	int stride;			// in bytes
 	int local;
+	int interleaved;	// ptr is inside GSalt_t::interleaved
 } fpointer;
 
 typedef	union {
@@ -37,6 +47,9 @@ typedef struct {
 
 #define SIGN 0x72730103
 
+// vertex converted at a time, on ingest and output
+#define GSALT_BLOCK 256
+
 typedef struct {
 	int signature;
 	int num_vertex;
@@ -45,8 +58,45 @@ typedef struct {
 	int decimed_triangles;
 	int faces_defined;
 	unsigned int flags;
+	float decimed_error;
+	float decimed_rms;
+	float bbox_min[3];
+	float bbox_max[3];
+	float uv_min[2];	// range of the simplified texcoords
+	float uv_max[2];
+	float center[3];
+	float radius;
+
+	gsalt_stats stats;
 
 	MxStdModel *model;
+	unsigned char *lock;	// num_vertex flags of gsalt_lock_vertices / gsalt_lock_mask, NULL if none
+	// GSALT_SPATIAL_ORDER: the model is renumbered at the first simplify, the outputs keep the given order
+	uint32_t *model_vertex;		// given vertex -> model vertex, NULL if not renumbered
+	uint32_t *given_vertex;		// model vertex -> given vertex
+	uint32_t *model_face;		// given face -> model face
+
+	gsalt_progress_callback progress;	// NULL if none
+	void *progress_data;
+	double time_budget;		// seconds from the start of gsalt_simplify, 0 for none
+
+	// the simplification in progress, from gsalt_simplify_begin to gsalt_simplify_end (NULL if none)
+	MxStdSlim *slim;
+	unsigned char *slim_lock;	// lock in the model order, pgsalt->lock if not renumbered
+	int slim_done;			// the decimation is over, only gsalt_simplify_end is left
+	int objective;
+	real error_unit;		// costs are divided by it for GSALT_ERROR_RELATIVE
+	double time_start;
+	double time_setup;
+	double time_decimate;	// all the steps
+	size_t setup_bytes;
+
+	// gsalt_simplify_async, async_pending is read and cleared under the pool lock
+	int async_pending;
+	int async_objective;
+	int async_result;
+	gsalt_simplify_callback async_callback;
+	void *async_data;
 
 	fpointer vertex;
 	fpointer color;
@@ -55,17 +105,22 @@ typedef struct {
 
 	spointer indexes;
 
+	char *interleaved;	// buffer of gsalt_array_interleaved (stride in bytes)
+	int interleaved_stride;
+
 } GSalt_t, *PGSalt;
 
-inline void init_pointer(fpointer* p, float* ptr, int size, int stride, int local)
+inline void init_pointer(fpointer* p, void* ptr, int type, int size, int stride, int local)
 {
-	p->ptr = ptr;
+	p->ptr = (char*)ptr;
+	p->type = type;
 	p->size = size;
 	if (stride)
 		p->stride = stride;
 	else
-		p->stride = size;
+		p->stride = gsalt_element_bytes(type, size);
 	p->local = local;
+	p->interleaved = 0;
 }
 inline void init_pointer(spointer* p, void* ptr, int size, int stride, int local, int type)
 {
@@ -82,16 +137,29 @@ inline void init_pointer(spointer* p, void* ptr, int size, int stride, int local
 	p->type = type;
 }
 
+gsalt_log_callback log_callback = NULL;
+void* log_userdata = NULL;
+
 void gsalt_log(gsalt_verbose level, const char *fmt, ...)
 {
 	if (level <= verbose_level) {
 		va_list argptr;
 		va_start(argptr, fmt);
-    	vprintf(fmt, argptr);
+		if (log_callback)
+			gsalt_logring_push(level, fmt, argptr);
+		else
+    		vprintf(fmt, argptr);
     	va_end(argptr);
 	}
 }
 
+// the per element logs cost a call and the varargs even when filtered out, so they are only in LOG_ALL builds
+#ifdef GSALT_LOG_ALL
+#define gsalt_log_all(...) gsalt_log(gsalt_verbose_all, __VA_ARGS__)
+#else
+#define gsalt_log_all(...)
+#endif
+
 gslat_return gsalt_init() {
 	if (gsalt_inited)
 		return GSALT_OK;
@@ -110,6 +178,10 @@ gslat_return gsalt_init() {
 			verbose_level = gsalt_verbose_none;
 	}
 
+	env = getenv("GSALT_TRACE");
+	if (env && !gsalt_trace_open(env))
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot open trace file \"%s\"\n", env);
+
 	gsalt_inited = 1;
 
 	return GSALT_OK;
@@ -127,6 +199,41 @@ gsalt_verbose gsalt_set_verbose(gsalt_verbose new_level) {
 	return old;
 }
 
+gslat_return gsalt_set_trace_file(const char *filename) {
+	gsalt_log(gsalt_verbose_debug, "GSalt: Trace file = %s\n", filename?filename:"(none)");
+	if (!gsalt_trace_open(filename)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot open trace file \"%s\"\n", filename);
+		return GSALT_ERROR;
+	}
+	return GSALT_OK;
+}
+
+static void log_deliver(int level, const char *msg, void *data) {
+	log_callback((gsalt_verbose)level, msg, log_userdata);
+}
+
+int gsalt_flush_log() {
+	if (!log_callback)
+		return 0;
+	int count = gsalt_logring_drain(log_deliver, NULL);
+	unsigned int dropped = gsalt_logring_dropped();
+	if (dropped) {
+		char msg[80];
+		snprintf(msg, sizeof(msg), "GSalt: %u log messages dropped (ring buffer full)\n", dropped);
+		log_callback(gsalt_verbose_warning, msg, log_userdata);
+		count++;
+	}
+	return count;
+}
+
+gslat_return gsalt_set_log_callback(gsalt_log_callback callback, void *userdata) {
+	// what was logged so far goes to the previous callback
+	gsalt_flush_log();
+	log_callback = callback;
+	log_userdata = userdata;
+	return GSALT_OK;
+}
+
 GSalt gsalt_new(int num_vertex, int num_triangles, unsigned int flags) {
 	if (!gsalt_inited) gsalt_init();
 	gsalt_log(gsalt_verbose_debug, "GSalt: New Gsalt object, %d vertex, %d triangles, flags = %x\n", num_vertex, num_triangles, flags);
@@ -151,13 +258,30 @@ GSalt gsalt_new(int num_vertex, int num_triangles, unsigned int flags) {
 	pgsalt->faces_defined = 0;
 	pgsalt->decimed_vertex = 0;
 	pgsalt->decimed_triangles = 0;
+	pgsalt->decimed_error = 0.0f;
+	pgsalt->decimed_rms = 0.0f;
+	pgsalt->radius = -1.0f;
+	memset(&pgsalt->stats, 0, sizeof(gsalt_stats));
 
-	init_pointer(&pgsalt->vertex, NULL, 4, 0, 1);
-	init_pointer(&pgsalt->normal, NULL, 3, 0, 1);
-	init_pointer(&pgsalt->color, NULL, 4, 0, 1);
-	init_pointer(&pgsalt->texcoord, NULL, 4, 0, 1);
+	init_pointer(&pgsalt->vertex, NULL, GSALT_FLOAT, 4, 0, 1);
+	init_pointer(&pgsalt->normal, NULL, GSALT_FLOAT, 3, 0, 1);
+	init_pointer(&pgsalt->color, NULL, GSALT_FLOAT, 4, 0, 1);
+	init_pointer(&pgsalt->texcoord, NULL, GSALT_FLOAT, 4, 0, 1);
 
 	init_pointer(&pgsalt->indexes, NULL, 1, 0, 1, GSALT_UINT32);
+	pgsalt->interleaved = NULL;
+	pgsalt->interleaved_stride = 0;
+	pgsalt->lock = NULL;
+	pgsalt->model_vertex = NULL;
+	pgsalt->progress = NULL;
+	pgsalt->progress_data = NULL;
+	pgsalt->time_budget = 0.0;
+	pgsalt->slim = NULL;
+	pgsalt->slim_lock = NULL;
+	pgsalt->async_pending = 0;
+	pgsalt->async_result = GSALT_ERROR;
+	pgsalt->given_vertex = NULL;
+	pgsalt->model_face = NULL;
 
 	pgsalt->model = new MxStdModel(num_vertex, num_triangles);
 
@@ -173,18 +297,38 @@ GSalt gsalt_new(int num_vertex, int num_triangles, unsigned int flags) {
 #define check_gsalt \
 		PGSalt pgsalt = (PGSalt)gsalt;  \
 		if(pgsalt->signature!=SIGN) {gsalt_log(gsalt_verbose_error, "GSalt: GSalt object is not valid\n"); return GSALT_ERROR;}
+// the object belongs to the worker until an asynchronous simplification is done
+#define check_async \
+		if(gsalt_pool_pending(&pgsalt->async_pending)) {gsalt_log(gsalt_verbose_error, "GSalt: Asynchronous simplification in progress\n"); return GSALT_ERROR;}
+// the model can't change under a simplification in progress
+#define check_idle \
+		check_async \
+		if(pgsalt->slim) {gsalt_log(gsalt_verbose_error, "GSalt: Simplification in progress, call gsalt_simplify_end first\n"); return GSALT_ERROR;}
+
+static void simplify_abort(PGSalt pgsalt);
 
 gslat_return gsalt_delete(GSalt gsalt) {
 	gsalt_log(gsalt_verbose_debug, "GSalt: Delete GSalt object\n");
 
 	check_gsalt;
 
+	// the worker writes the outputs back, let it finish before freeing anything
+	if(gsalt_pool_pending(&pgsalt->async_pending)) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: Wait for the asynchronous simplification\n");
+		gsalt_pool_wait(&pgsalt->async_pending);
+	}
+	if(pgsalt->slim) simplify_abort(pgsalt);
+
 	if(pgsalt->vertex.local) free(pgsalt->vertex.ptr);
 	if(pgsalt->color.local) free(pgsalt->color.ptr);
 	if(pgsalt->normal.local) free(pgsalt->normal.ptr);
 	if(pgsalt->texcoord.local) free(pgsalt->texcoord.ptr);
 
 	if(pgsalt->indexes.local) free(pgsalt->indexes.ptr.ui32);
+	free(pgsalt->lock);
+	free(pgsalt->model_vertex);
+	free(pgsalt->given_vertex);
+	free(pgsalt->model_face);
 
 	if(pgsalt->model) delete pgsalt->model;
 
@@ -197,7 +341,8 @@ gslat_return gsalt_delete(GSalt gsalt) {
 
 gslat_return gsalt_add_color(GSalt gsalt, float r, float g, float b, float a) {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: add a color vertex(%f, %f, %f, %f)\n", r, g, b, a);
+	check_idle;
+	gsalt_log_all("GSalt: add a color vertex(%f, %f, %f, %f)\n", r, g, b, a);
 
 	pgsalt->model->add_color(r, g, b, a);
 
@@ -205,7 +350,8 @@ gslat_return gsalt_add_color(GSalt gsalt, float r, float g, float b, float a) {
 }
 gslat_return gsalt_add_normal(GSalt gsalt, float x, float y, float z) {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: add a normal(%f, %f, %f)\n", x, y, z);
+	check_idle;
+	gsalt_log_all("GSalt: add a normal(%f, %f, %f)\n", x, y, z);
 
 	pgsalt->model->add_normal(x, y, z);
 
@@ -213,7 +359,8 @@ gslat_return gsalt_add_normal(GSalt gsalt, float x, float y, float z) {
 }
 gslat_return gsalt_add_texcoord(GSalt gsalt, float s, float t, float r, float q) {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: add a texcoord(%f, %f)\n", s, t);
+	check_idle;
+	gsalt_log_all("GSalt: add a texcoord(%f, %f)\n", s, t);
 
 	pgsalt->model->add_texcoord(s, t);
 
@@ -221,7 +368,8 @@ gslat_return gsalt_add_texcoord(GSalt gsalt, float s, float t, float r, float q)
 }
 gslat_return gsalt_add_vertex(GSalt gsalt, float x, float y, float z, float w) {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: add a vertex(%f, %f, %f)\n", x, y, z);
+	check_idle;
+	gsalt_log_all("GSalt: add a vertex(%f, %f, %f)\n", x, y, z);
 
 	pgsalt->model->add_vertex(x, y, z);
 
@@ -230,7 +378,8 @@ gslat_return gsalt_add_vertex(GSalt gsalt, float x, float y, float z, float w) {
 
 gslat_return gsalt_add_triangle(GSalt gsalt, int idx1, int idx2, int idx3) {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: add a triangle(%d, %d, %d)\n", idx1, idx2, idx3);
+	check_idle;
+	gsalt_log_all("GSalt: add a triangle(%d, %d, %d)\n", idx1, idx2, idx3);
 
 	pgsalt->model->add_face(idx1, idx2, idx3);
 
@@ -239,8 +388,33 @@ gslat_return gsalt_add_triangle(GSalt gsalt, int idx1, int idx2, int idx3) {
 	return GSALT_OK;
 }
 
+// Unit of the contraction costs: squared distance, also weighted by area for the QSlim strategies
+static real error_scale(PGSalt pgsalt, MxStdSlim *slim)
+{
+	MxStdModel *m = pgsalt->model;
+	if(!m->vert_count())
+		return 1.0;
+	float lo[3], hi[3];
+	for (int k=0; k<3; k++)
+		lo[k] = hi[k] = m->vertex(0)[k];
+	for (unsigned int i=1; i<m->vert_count(); i++)
+		for (int k=0; k<3; k++) {
+			if(m->vertex(i)[k]<lo[k]) lo[k] = m->vertex(i)[k];
+			if(m->vertex(i)[k]>hi[k]) hi[k] = m->vertex(i)[k];
+		}
+	real d2 = 0.0;
+	for (int k=0; k<3; k++)
+		d2 += (real)(hi[k]-lo[k])*(hi[k]-lo[k]);
+	if(d2<=0.0)
+		return 1.0;
+	return slim->area_weighted()?d2*d2:d2;
+}
+
+static int simplify(PGSalt pgsalt, int objective, real error_limit, int error_mode);
+
 int gsalt_simplify(GSalt gsalt, int objective) {
 	check_gsalt;
+	check_idle;
 	gsalt_log(gsalt_verbose_debug, "GSalt: Simplify, objective=%d\n", objective);
 
 	if(objective<3) {
@@ -248,15 +422,261 @@ int gsalt_simplify(GSalt gsalt, int objective) {
 		return GSALT_ERROR;
 	}
 
+	return simplify(pgsalt, objective, HUGE_VAL, GSALT_ERROR_ABSOLUTE);
+}
+
+int gsalt_simplify_error(GSalt gsalt, float max_error, int min_triangles, int mode, float *achieved_error) {
+	check_gsalt;
+	check_idle;
+	gsalt_log(gsalt_verbose_debug, "GSalt: Simplify, max_error=%g (%s), min_triangles=%d\n", max_error, (mode==GSALT_ERROR_RELATIVE)?"relative":"absolute", min_triangles);
+
+	if(max_error<0.0f) {
+		gsalt_log(gsalt_verbose_warning, "GSalt: Simplify, negative max_error(%g) !\n", max_error);
+		return GSALT_ERROR;
+	}
+	if(min_triangles<3)
+		min_triangles = 3;
+
+	int ret = simplify(pgsalt, min_triangles, max_error, mode);
+	if(achieved_error) *achieved_error = pgsalt->decimed_error;
+
+	return ret;
+}
+
+static void simplify_begin(PGSalt pgsalt, int objective, real error_limit, int error_mode);
+static int simplify_end(PGSalt pgsalt);
+
+gslat_return gsalt_simplify_begin(GSalt gsalt, int objective) {
+	check_gsalt;
+	check_idle;
+	gsalt_log(gsalt_verbose_debug, "GSalt: Simplify begin, objective=%d\n", objective);
+
+	if(objective<3) {
+		gsalt_log(gsalt_verbose_warning, "GSalt: Simplify, objective too low(%d) !\n", objective);
+		return GSALT_ERROR;
+	}
+
+	simplify_begin(pgsalt, objective, HUGE_VAL, GSALT_ERROR_ABSOLUTE);
+	return GSALT_OK;
+}
+
+int gsalt_simplify_step(GSalt gsalt, int max_contractions, int microseconds) {
+	check_gsalt;
+	check_async;
+	MxStdSlim *slim = pgsalt->slim;
+	if(!slim) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Simplify step without gsalt_simplify_begin\n");
+		return GSALT_ERROR;
+	}
+	if(max_contractions<0 || microseconds<0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Simplify step, negative limit (%d, %d)\n", max_contractions, microseconds);
+		return GSALT_ERROR;
+	}
+	if(pgsalt->slim_done)
+		return 0;
+
+	double t1 = gsalt_time();
+	slim->stopped = false;
+	slim->contraction_limit = (max_contractions)?slim->contraction_count+max_contractions:0;
+	slim->deadline = (microseconds)?t1+microseconds*1e-6:0.0;
+	slim->decimate(pgsalt->objective);
+	double t2 = gsalt_time();
+	gsalt_trace_complete("decimate", t1, t2);
+	pgsalt->time_decimate += t2-t1;
+
+	// not stopped by the limits of this step: objective, error limit, or cancelled
+	if(!slim->stopped || pgsalt->stats.stopped!=GSALT_STOPPED_NONE) {
+		pgsalt->slim_done = 1;
+		return 0;
+	}
+	return slim->valid_faces;
+}
+
+int gsalt_simplify_end(GSalt gsalt) {
+	check_gsalt;
+	check_async;
+	if(!pgsalt->slim) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Simplify end without gsalt_simplify_begin\n");
+		return GSALT_ERROR;
+	}
+	return simplify_end(pgsalt);
+}
+
+static void simplify_job(void *data) {
+	PGSalt pgsalt = (PGSalt)data;
+	int ret = simplify(pgsalt, pgsalt->async_objective, HUGE_VAL, GSALT_ERROR_ABSOLUTE);
+	gsalt_simplify_callback callback = pgsalt->async_callback;
+	void *userdata = pgsalt->async_data;
+	pgsalt->async_result = ret;
+	gsalt_pool_signal(&pgsalt->async_pending);
+	// the object may be deleted from here on
+	if(callback)
+		callback((GSalt)pgsalt, ret, userdata);
+}
+
+gslat_return gsalt_simplify_async(GSalt gsalt, int objective, gsalt_simplify_callback callback, void *userdata) {
+	check_gsalt;
+	check_idle;
+	gsalt_log(gsalt_verbose_debug, "GSalt: Simplify asynchronously, objective=%d\n", objective);
+
+	if(objective<3) {
+		gsalt_log(gsalt_verbose_warning, "GSalt: Simplify, objective too low(%d) !\n", objective);
+		return GSALT_ERROR;
+	}
+
+	pgsalt->async_objective = objective;
+	pgsalt->async_callback = callback;
+	pgsalt->async_data = userdata;
+	pgsalt->async_result = GSALT_ERROR;
+	pgsalt->async_pending = 1;
+	gsalt_pool_submit(simplify_job, pgsalt);
+	return GSALT_OK;
+}
+
+int gsalt_simplify_poll(GSalt gsalt) {
+	check_gsalt;
+	if(gsalt_pool_pending(&pgsalt->async_pending))
+		return GSALT_PENDING;
+	return pgsalt->async_result;
+}
+
+int gsalt_simplify_wait(GSalt gsalt) {
+	check_gsalt;
+	gsalt_pool_wait(&pgsalt->async_pending);
+	return pgsalt->async_result;
+}
+
+gslat_return gsalt_set_threads(int n) {
+	if(n<0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: negative number of threads (%d)\n", n);
+		return GSALT_ERROR;
+	}
+	gsalt_log(gsalt_verbose_debug, "GSalt: %d simplification threads\n", n);
+	gsalt_pool_set_threads(n);
+	return GSALT_OK;
+}
+
+static bool trace_progress(MxStdSlim *slim, void *data) {
+	gsalt_trace_counter("valid_faces", slim->valid_faces);
+	return true;
+}
+
+// every GSALT_PROGRESS_INTERVAL contractions when there is a progress callback
+static bool report_progress(MxStdSlim *slim, void *data) {
+	PGSalt pgsalt = (PGSalt)data;
+	if(gsalt_trace_enabled())
+		trace_progress(slim, NULL);
+	if(pgsalt->progress((GSalt)pgsalt, slim->valid_faces, pgsalt->progress_data)) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: Simplification cancelled at %u triangles\n", slim->valid_faces);
+		pgsalt->stats.stopped = GSALT_STOPPED_CALLBACK;
+		return false;
+	}
+	return true;
+}
+
+// GSALT_SPATIAL_ORDER: renumber the vertex along a Morton curve and the faces by their first vertex,
+// so the decimation walks the memory in about the same order as the space. The model is rebuilt
+// before the first simplify touches it, the maps give back the numbering of the outputs.
+static void spatial_order(PGSalt pgsalt) {
+	MxStdModel *m = pgsalt->model;
+	unsigned int nv = m->vert_count(), nf = m->face_count();
+	if(((pgsalt->flags&GSALT_COLOR) && m->color_count()!=nv) || ((pgsalt->flags&GSALT_NORMAL) && m->normal_count()!=nv)
+	  || ((pgsalt->flags&GSALT_TEXCOORD) && m->texcoord_count()!=nv)) {
+		gsalt_log(gsalt_verbose_warning, "GSalt: some vertex have no color/normal/texcoord, not reordered\n");
+		return;
+	}
+	uint32_t *tris = (uint32_t*)malloc(sizeof(uint32_t)*nf*3);
+	for (unsigned int f=0; f<nf; f++)
+		for (int k=0; k<3; k++)
+			if((tris[f*3+k] = m->face(f).v[k])>=nv) {
+				gsalt_log(gsalt_verbose_warning, "GSalt: triangle %u uses vertex %u, only %u given, not reordered\n", f, tris[f*3+k], nv);
+				free(tris);
+				return;
+			}
+	double t0 = gsalt_time();
+	gsalt_log(gsalt_verbose_debug, "GSalt: spatial order of %u vertex, %u triangles\n", nv, nf);
+	float *points = (float*)malloc(sizeof(float)*nv*3);
+	for (unsigned int i=0; i<nv; i++)
+		for (int k=0; k<3; k++)
+			points[i*3+k] = m->vertex(i)[k];
+	uint32_t *given = (uint32_t*)malloc(sizeof(uint32_t)*nv);
+	uint32_t *rank = (uint32_t*)malloc(sizeof(uint32_t)*nv);
+	gsalt_morton_order(points, nv, given);
+	free(points);
+	for (unsigned int r=0; r<nv; r++)
+		rank[given[r]] = r;
+	uint32_t *forder = (uint32_t*)malloc(sizeof(uint32_t)*nf);
+	uint32_t *fmap = (uint32_t*)malloc(sizeof(uint32_t)*nf);
+	gsalt_face_order(tris, nf, rank, nv, forder);
+
+	MxStdModel *r = new MxStdModel(pgsalt->num_vertex, pgsalt->num_triangles);
+	r->color_binding((pgsalt->flags&GSALT_COLOR)?MX_PERVERTEX:MX_UNBOUND);
+	r->normal_binding((pgsalt->flags&GSALT_NORMAL)?MX_PERVERTEX:MX_UNBOUND);
+	r->texcoord_binding((pgsalt->flags&GSALT_TEXCOORD)?MX_PERVERTEX:MX_UNBOUND);
+	for (unsigned int j=0; j<nv; j++) {
+		unsigned int i = given[j];
+		r->add_vertex(m->vertex(i)[0], m->vertex(i)[1], m->vertex(i)[2]);
+		if(pgsalt->flags&GSALT_COLOR) r->add_color(m->color(i).as.word);
+		if(pgsalt->flags&GSALT_NORMAL) r->add_normal(m->normal(i)[0], m->normal(i)[1], m->normal(i)[2]);
+		if(pgsalt->flags&GSALT_TEXCOORD) r->add_texcoord(m->texcoord(i).u[0], m->texcoord(i).u[1]);
+	}
+	for (unsigned int j=0; j<nf; j++) {
+		unsigned int f = forder[j];
+		fmap[f] = j;
+		r->add_face(rank[tris[f*3+0]], rank[tris[f*3+1]], rank[tris[f*3+2]]);
+	}
+	free(forder);
+	free(tris);
+	delete m;
+	pgsalt->model = r;
+	pgsalt->model_vertex = rank;
+	pgsalt->given_vertex = given;
+	pgsalt->model_face = fmap;
+	gsalt_trace_complete("spatial_order", t0, gsalt_time());
+}
+
+// a face of the model, in the numbering of the given vertex
+static void given_face(PGSalt pgsalt, int index, uint32_t v[3]) {
+	if(pgsalt->model_face) {
+		const MxFace& f = pgsalt->model->face(pgsalt->model_face[index]);
+		for (int k=0; k<3; k++)
+			v[k] = pgsalt->given_vertex[f.v[k]];
+	} else {
+		const MxFace& f = pgsalt->model->face(index);
+		for (int k=0; k<3; k++)
+			v[k] = f.v[k];
+	}
+}
+
+// given vertex -> model vertex
+static unsigned int model_index(PGSalt pgsalt, int index) {
+	return (pgsalt->model_vertex)?pgsalt->model_vertex[index]:index;
+}
+
+// builds the slim and its heap, and leaves them in pgsalt->slim
+static void simplify_begin(PGSalt pgsalt, int objective, real error_limit, int error_mode) {
+	double t0 = gsalt_time();
+	pgsalt->stats.stopped = GSALT_STOPPED_NONE;
 	if(pgsalt->faces_defined==0) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: create a dummy triangle list\n");
 		for (int i=0; i<pgsalt->num_triangles; i++)
 			pgsalt->model->add_face(i*3+0, i*3+1, i*3+2);
 	}
+	if((pgsalt->flags&GSALT_SPATIAL_ORDER) && !pgsalt->model_vertex)
+		spatial_order(pgsalt);
+	unsigned char *lock = pgsalt->lock;
+	if(lock && pgsalt->model_vertex) {
+		lock = (unsigned char*)malloc(pgsalt->num_vertex);
+		for (unsigned int i=0; i<pgsalt->model->vert_count(); i++)
+			lock[pgsalt->model_vertex[i]] = pgsalt->lock[i];
+	}
 	MxStdSlim *slim;
 	if (pgsalt->flags&GSALT_FACE) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: Simplify using %s strategy\n", "Face");
 		slim = new MxFaceQSlim(*pgsalt->model);
+	} else if (pgsalt->flags&GSALT_HALFEDGE) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: Simplify using %s strategy\n", "HalfEdge");
+		slim = new MxHalfEdgeQSlim(*pgsalt->model);
 	} else if (pgsalt->flags&GSALT_EDGE) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: Simplify using %s strategy\n", "Edge");
 		slim = new MxEdgeQSlim(*pgsalt->model);
@@ -264,10 +684,84 @@ int gsalt_simplify(GSalt gsalt, int objective) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: Simplify using %s strategy\n", "Prop");
 		slim = new MxPropSlim(*pgsalt->model);
 	}
+	slim->vertex_lock = lock;
 	slim->initialize();
+	if ((pgsalt->flags&GSALT_HALFEDGE) && !(pgsalt->flags&GSALT_FACE) && !((MxHalfEdgeQSlim*)slim)->is_manifold()) {
+		gsalt_log(gsalt_verbose_warning, "GSalt: Mesh is not manifold, simplify using %s strategy\n", "Edge");
+		delete slim;
+		slim = new MxEdgeQSlim(*pgsalt->model);
+		slim->vertex_lock = lock;
+		slim->initialize();
+	}
+	// in the unit of the engine that runs, which may not be the one asked for
+	pgsalt->error_unit = (error_mode==GSALT_ERROR_RELATIVE)?error_scale(pgsalt, slim):1.0;
+	slim->error_limit = error_limit*pgsalt->error_unit;
+	size_t peak_bytes = slim->memory_usage();
+	double t1 = gsalt_time();
+	if(pgsalt->progress) {
+		slim->progress_callback = report_progress;
+		slim->progress_data = pgsalt;
+		slim->progress_interval = GSALT_PROGRESS_INTERVAL;
+		if(gsalt_trace_enabled())
+			trace_progress(slim, NULL);
+	} else if(gsalt_trace_enabled()) {
+		// ~256 samples of the decimation progress
+		slim->progress_callback = trace_progress;
+		if(slim->valid_faces > (unsigned int)objective)
+			slim->progress_interval = (slim->valid_faces-objective)/256 + 1;
+		trace_progress(slim, NULL);
+	}
+	gsalt_trace_complete("initialize", t0, t1);
+
+	pgsalt->slim = slim;
+	pgsalt->slim_lock = lock;
+	pgsalt->slim_done = 0;
+	pgsalt->objective = objective;
+	pgsalt->time_start = t0;
+	pgsalt->time_setup = t1-t0;
+	pgsalt->time_decimate = 0.0;
+	pgsalt->setup_bytes = peak_bytes;
+}
+
+static void simplify_abort(PGSalt pgsalt) {
+	gsalt_log(gsalt_verbose_debug, "GSalt: Drop the simplification in progress\n");
+	delete pgsalt->slim;
+	if(pgsalt->slim_lock!=pgsalt->lock)
+		free(pgsalt->slim_lock);
+	pgsalt->slim = NULL;
+	pgsalt->slim_lock = NULL;
+}
+
+static int simplify(PGSalt pgsalt, int objective, real error_limit, int error_mode) {
+	gsalt_trace_begin("gsalt_simplify");
+	simplify_begin(pgsalt, objective, error_limit, error_mode);
+	MxStdSlim *slim = pgsalt->slim;
+	if(pgsalt->time_budget > 0.0)
+		slim->deadline = pgsalt->time_start + pgsalt->time_budget;
+	double t1 = gsalt_time();
 	slim->decimate(objective);
+	double t2 = gsalt_time();
+	gsalt_trace_complete("decimate", t1, t2);
+	pgsalt->time_decimate = t2-t1;
+	if(slim->stopped && pgsalt->stats.stopped==GSALT_STOPPED_NONE) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: Time budget reached at %u triangles\n", slim->valid_faces);
+		pgsalt->stats.stopped = GSALT_STOPPED_TIME;
+	}
+	int ret = simplify_end(pgsalt);
+	gsalt_trace_end("gsalt_simplify");
+	return ret;
+}
+
+// writes the decimated model back in the arrays, and drops the slim
+static int simplify_end(PGSalt pgsalt) {
+	MxStdSlim *slim = pgsalt->slim;
+	double t2 = gsalt_time();
+	if(gsalt_trace_enabled())
+		trace_progress(slim, NULL);
+	pgsalt->decimed_error = slim->achieved_error/pgsalt->error_unit;
+	pgsalt->decimed_rms = ((slim->contraction_count)?sqrt(slim->error_sum2/slim->contraction_count):0.0)/pgsalt->error_unit;
 	// now, get back the values in the arrays
-#define alloc_ptr(A) pgsalt->A.ptr = (float*)realloc(pgsalt->A.ptr, sizeof(float)*pgsalt->num_vertex*pgsalt->A.size);
+#define alloc_ptr(A) pgsalt->A.ptr = (char*)realloc(pgsalt->A.ptr, pgsalt->num_vertex*pgsalt->A.stride);
 	if(pgsalt->vertex.local) {
 		alloc_ptr(vertex);
 	}
@@ -292,127 +786,215 @@ int gsalt_simplify(GSalt gsalt, int objective) {
 	unsigned int max_vertex = pgsalt->model->vert_count();
 	unsigned int max_faces = pgsalt->model->face_count();
 
-	int *match;
-	match = (int*)malloc(sizeof(int)*max_vertex);
+	// match is model vertex -> output vertex, vlist is output vertex -> model vertex
+	uint32_t *match, *vlist, *tris;
+	match = (uint32_t*)malloc(sizeof(uint32_t)*max_vertex);
+	vlist = (uint32_t*)malloc(sizeof(uint32_t)*max_vertex);
+	tris = (uint32_t*)malloc(sizeof(uint32_t)*max_faces*3);
 
-	float *vertex, *color, *normal, *texcoord;
+	fpointer *vertex, *color, *normal, *texcoord;
 	uint16_t *ind16;
 	uint32_t *ind32;
 
-	vertex = pgsalt->vertex.ptr;
-	color = (pgsalt->flags&GSALT_COLOR)?pgsalt->color.ptr:NULL;
-	normal = (pgsalt->flags&GSALT_NORMAL)?pgsalt->normal.ptr:NULL;
-	texcoord = 	(pgsalt->flags&GSALT_TEXCOORD)?pgsalt->texcoord.ptr:NULL;
+	vertex = &pgsalt->vertex;
+	color = (pgsalt->flags&GSALT_COLOR)?&pgsalt->color:NULL;
+	normal = (pgsalt->flags&GSALT_NORMAL)?&pgsalt->normal:NULL;
+	texcoord = 	(pgsalt->flags&GSALT_TEXCOORD)?&pgsalt->texcoord:NULL;
 
 	pgsalt->decimed_vertex = 0;
 	pgsalt->decimed_triangles = 0;
 
-	for (unsigned int i=0; i<max_vertex; i++) {
+	// in the given order, even if the model was renumbered
+	for (unsigned int j=0; j<max_vertex; j++) {
+		unsigned int i = (pgsalt->model_vertex)?pgsalt->model_vertex[j]:j;
 		if (pgsalt->model->vertex_is_valid(i) && (pgsalt->decimed_vertex<pgsalt->num_vertex)) {
-			vertex[0] = pgsalt->model->vertex(i).as.pos[0]; vertex[1] = pgsalt->model->vertex(i).as.pos[1]; vertex[2] = pgsalt->model->vertex(i).as.pos[2];
-			if(pgsalt->vertex.size>3) vertex[3] = 1.0f;
-			vertex += pgsalt->vertex.stride;
+			vlist[pgsalt->decimed_vertex] = i;
+			match[i]=pgsalt->decimed_vertex++;
+		}
+	}
+	int newFaces = 0;
+	for (unsigned int j=0; j<max_faces; j++) {
+		unsigned int i = (pgsalt->model_face)?pgsalt->model_face[j]:j;
+		if (pgsalt->model->face_is_valid(i)) {
+			tris[newFaces*3+0]=match[pgsalt->model->face(i).v[0]];
+			tris[newFaces*3+1]=match[pgsalt->model->face(i).v[1]];
+			tris[newFaces*3+2]=match[pgsalt->model->face(i).v[2]];
+			newFaces++;
+		}
+	}
+
+	if(pgsalt->flags&GSALT_OPTIMIZE_VCACHE) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: optimize vertex cache and vertex fetch order\n");
+		gsalt_optimize_vcache(tris, newFaces, pgsalt->decimed_vertex);
+		// match is now used as old output vertex -> new output vertex
+		gsalt_optimize_vfetch(tris, newFaces, pgsalt->decimed_vertex, match);
+		uint32_t *order = (uint32_t*)malloc(sizeof(uint32_t)*pgsalt->decimed_vertex);
+		for (int i=0; i<pgsalt->decimed_vertex; i++)
+			order[match[i]] = vlist[i];
+		memcpy(vlist, order, sizeof(uint32_t)*pgsalt->decimed_vertex);
+		free(order);
+	}
+
+	for (int k=0; k<3; k++) {
+		pgsalt->bbox_min[k] = (pgsalt->decimed_vertex)?pgsalt->model->vertex(vlist[0])[k]:0.0f;
+		pgsalt->bbox_max[k] = pgsalt->bbox_min[k];
+	}
+	for (int k=0; k<2; k++) {
+		pgsalt->uv_min[k] = (texcoord && pgsalt->decimed_vertex)?pgsalt->model->texcoord(vlist[0]).u[k]:0.0f;
+		pgsalt->uv_max[k] = pgsalt->uv_min[k];
+	}
+	// gather a block of vertex as floats, then encode it to the type of each array
+	float block[4][GSALT_BLOCK*4];
+	for (int first=0; first<pgsalt->decimed_vertex; first+=GSALT_BLOCK) {
+		int count = (pgsalt->decimed_vertex-first<GSALT_BLOCK)?(pgsalt->decimed_vertex-first):GSALT_BLOCK;
+		for (int j=0; j<count; j++) {
+			unsigned int i = vlist[first+j];
+			float *v = block[0]+j*4;
+			for (int k=0; k<3; k++) {
+				float p = pgsalt->model->vertex(i)[k];
+				if(p<pgsalt->bbox_min[k]) pgsalt->bbox_min[k] = p;
+				if(p>pgsalt->bbox_max[k]) pgsalt->bbox_max[k] = p;
+				v[k] = p;
+			}
+			v[3] = 1.0f;
 			if(color) {
-				color[0] = pgsalt->model->color(i).R();
-				color[1] = pgsalt->model->color(i).G();
-				color[2] = pgsalt->model->color(i).B();
-				if(pgsalt->color.size>3)
-					color[3] = pgsalt->model->color(i).A();
-				color += pgsalt->color.stride;
+				float *c = block[1]+j*4;
+				c[0] = pgsalt->model->color(i).R();
+				c[1] = pgsalt->model->color(i).G();
+				c[2] = pgsalt->model->color(i).B();
+				c[3] = pgsalt->model->color(i).A();
 			}
 			if(normal) {
-				normal[0] = pgsalt->model->normal(i)[0]; normal[1] = pgsalt->model->normal(i)[1]; normal[2] = pgsalt->model->normal(i)[2];
-				normal += pgsalt->normal.stride;
+				float *n = block[2]+j*4;
+				n[0] = pgsalt->model->normal(i)[0]; n[1] = pgsalt->model->normal(i)[1]; n[2] = pgsalt->model->normal(i)[2];
+				n[3] = 0.0f;
 			}
 			if(texcoord) {
-				texcoord[0] = pgsalt->model->texcoord(i).u[0]; texcoord[1] = pgsalt->model->texcoord(i).u[1];
-				if(pgsalt->texcoord.size>2) texcoord[2] = 0.0f;
-				if(pgsalt->texcoord.size>3) texcoord[3] = 1.0f;
-				texcoord += pgsalt->texcoord.stride;
+				float *t = block[3]+j*4;
+				for (int k=0; k<2; k++) {
+					t[k] = pgsalt->model->texcoord(i).u[k];
+					if(t[k]<pgsalt->uv_min[k]) pgsalt->uv_min[k] = t[k];
+					if(t[k]>pgsalt->uv_max[k]) pgsalt->uv_max[k] = t[k];
+				}
+				t[2] = 0.0f; t[3] = 1.0f;
 			}
-			match[i]=pgsalt->decimed_vertex++;
 		}
+#define encode(A, B) if(A) gsalt_encode(A->ptr+first*A->stride, A->stride, A->type, A->size, block[B], 4, count)
+		encode(vertex, 0);
+		encode(color, 1);
+		encode(normal, 2);
+		encode(texcoord, 3);
+#undef encode
 	}
-	int newFaces = 0;
 	if(pgsalt->indexes.type) {
 		ind16 = pgsalt->indexes.ptr.ui16;
-		for (int i=0; i<max_faces; i++) {
-			if (pgsalt->model->face_is_valid(i)) {
-				*(ind16++)=match[pgsalt->model->face(i).v[0]];
-				*(ind16++)=match[pgsalt->model->face(i).v[1]];
-				*(ind16++)=match[pgsalt->model->face(i).v[2]];
-				newFaces++;
-			}
-		}
+		for (int i=0; i<newFaces*3; i++)
+			*(ind16++)=tris[i];
 	} else {
 		ind32 = pgsalt->indexes.ptr.ui32;
-		for (int i=0; i<pgsalt->num_triangles; i++) {
-			if (pgsalt->model->face_is_valid(i)) {
-				*(ind32++)=match[pgsalt->model->face(i).v[0]];
-				*(ind32++)=match[pgsalt->model->face(i).v[1]];
-				*(ind32++)=match[pgsalt->model->face(i).v[2]];
-				newFaces++;
-			}
-		}
+		memcpy(ind32, tris, sizeof(uint32_t)*newFaces*3);
 	}
 
 	pgsalt->decimed_triangles=newFaces;
 
+	// bounding sphere centered on the box
+	float r2 = 0.0f;
+	for (int k=0; k<3; k++)
+		pgsalt->center[k] = (pgsalt->bbox_min[k]+pgsalt->bbox_max[k])*0.5f;
+	for (int j=0; j<pgsalt->decimed_vertex; j++) {
+		float d2 = 0.0f;
+		for (int k=0; k<3; k++) {
+			float d = pgsalt->model->vertex(vlist[j])[k] - pgsalt->center[k];
+			d2 += d*d;
+		}
+		if(d2>r2) r2 = d2;
+	}
+	pgsalt->radius = sqrtf(r2);
+
+	free(tris);
+	free(vlist);
 	free(match);
 
 	if(!pgsalt->faces_defined) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: no indexes, flatening the vertex list\n");
 		// indexes is not used here, so put the vertex "flat" and discard indexes array
-#define alloc(A,B) if((pgsalt->flags & B)==B) { \
-			A=(float*)malloc(sizeof(float)*pgsalt->num_vertex*pgsalt->A.stride);	\
-			memcpy(A, pgsalt->A.ptr, sizeof(float)*pgsalt->num_vertex*pgsalt->A.stride);	\
-		} else A=NULL
-		alloc(vertex, GSALT_VERTEX);
-		alloc(color, GSALT_COLOR);
-		alloc(texcoord, GSALT_TEXCOORD);
-		alloc(normal, GSALT_NORMAL);
-#undef alloc
+		// an interleaved buffer is copied once, its attributes point inside the copy
+		char *interleaved = NULL;
+		if(pgsalt->interleaved) {
+			interleaved = (char*)malloc(pgsalt->num_vertex*pgsalt->interleaved_stride);
+			memcpy(interleaved, pgsalt->interleaved, pgsalt->num_vertex*pgsalt->interleaved_stride);
+		}
+		char *src[4];
+		fpointer *dst[4] = {vertex, color, normal, texcoord};
+		for (int k=0; k<4; k++) {
+			fpointer *A = dst[k];
+			if(!A)
+				src[k] = NULL;
+			else if(A->interleaved)
+				src[k] = interleaved+(A->ptr-pgsalt->interleaved);
+			else {
+				// the last vertex ends with its size, not the stride (the array may be at an offset)
+				int len = (pgsalt->num_vertex-1)*A->stride+gsalt_element_bytes(A->type, A->size);
+				src[k] = (char*)malloc(len);
+				memcpy(src[k], A->ptr, len);
+			}
+		}
 		for (int i=0; i<pgsalt->decimed_triangles*3; i++) {
 			int idx = (pgsalt->indexes.type)?pgsalt->indexes.ptr.ui16[i]:pgsalt->indexes.ptr.ui32[i];
-			#define copy(A) if(A) memcpy(pgsalt->A.ptr+i*pgsalt->A.stride, A+idx*pgsalt->A.stride, sizeof(float)*pgsalt->A.size);
-			copy(vertex);
-			copy(normal);
-			copy(texcoord);
-			copy(color);
-			#undef copy
+			for (int k=0; k<4; k++)
+				if(src[k])
+					memcpy(dst[k]->ptr+i*dst[k]->stride, src[k]+idx*dst[k]->stride, gsalt_element_bytes(dst[k]->type, dst[k]->size));
 		}
-		free(vertex);
-		free(color);
-		free(normal);
-		free(texcoord);
+		for (int k=0; k<4; k++)
+			if(src[k] && !dst[k]->interleaved)
+				free(src[k]);
+		free(interleaved);
 		pgsalt->decimed_vertex = pgsalt->decimed_triangles*3;
 		free(pgsalt->indexes.ptr.ptr);
 		pgsalt->indexes.ptr.ptr=NULL;
 	}
+	double t3 = gsalt_time();
+	gsalt_trace_complete("output", t2, t3);
+	pgsalt->stats.time_initialize = pgsalt->time_setup;
+	pgsalt->stats.time_collect_quadrics = slim->time_quadrics;
+	pgsalt->stats.time_constrain_boundaries = slim->time_boundaries;
+	pgsalt->stats.time_collect_edges = slim->time_edges;
+	pgsalt->stats.time_decimate = pgsalt->time_decimate;
+	pgsalt->stats.time_output = t3-t2;
+	pgsalt->stats.heap_extracts = slim->heap_extracts;
+	pgsalt->stats.stale_extracts = slim->stale_extracts;
+	pgsalt->stats.rejected_extracts = slim->rejected_extracts;
+	pgsalt->stats.recomputations = slim->recomputations;
+	pgsalt->stats.optimize_fallbacks = slim->optimize_fallbacks;
+	// face lists grow while the heap shrinks: sample again, with the output buffers on top
+	size_t output_bytes = slim->memory_usage() + sizeof(uint32_t)*(max_vertex*2 + max_faces*3);
+	pgsalt->stats.peak_bytes = (output_bytes>pgsalt->setup_bytes)?output_bytes:pgsalt->setup_bytes;
+
 	gsalt_log(gsalt_verbose_warning, "GSalt: Simplified from %d(%d) to %d(%d)\n", 
 		pgsalt->num_vertex, pgsalt->num_triangles, pgsalt->decimed_vertex, pgsalt->decimed_triangles);
 
 	delete slim;
+	if(pgsalt->slim_lock!=pgsalt->lock)
+		free(pgsalt->slim_lock);
+	pgsalt->slim = NULL;
+	pgsalt->slim_lock = NULL;
 
 	if (pgsalt->decimed_vertex > pgsalt->num_vertex) {
 		gsalt_log(gsalt_verbose_error, "GSalt: Simplified failed, number of vertex increased\n");
 		pgsalt->decimed_vertex = 0;
 		pgsalt->decimed_triangles = 0;
-		free(match);
 		return GSALT_OK;
 	}
 	if (pgsalt->decimed_triangles > pgsalt->num_triangles) {
 		gsalt_log(gsalt_verbose_error, "GSalt: Simplified failed, number of triangles increased\n");
 		pgsalt->decimed_vertex = 0;
 		pgsalt->decimed_triangles = 0;
-		free(match);
 		return GSALT_OK;
 	}
 	if (!(pgsalt->faces_defined) && (pgsalt->decimed_triangles*3 > pgsalt->num_vertex)) {
 		gsalt_log(gsalt_verbose_error, "GSalt: Simplified failed, number of vertex increased\n");
 		pgsalt->decimed_vertex = 0;
 		pgsalt->decimed_triangles = 0;
-		free(match);
 		return GSALT_OK;
 	}
 
@@ -421,6 +1003,7 @@ int gsalt_simplify(GSalt gsalt, int objective) {
 
 int gsalt_query_numvertex(GSalt gsalt) {
 	check_gsalt;
+	check_async;
 	gsalt_log(gsalt_verbose_debug, "GSalt: query numvertex\n");
 
 	gsalt_log(gsalt_verbose_debug, "GSalt: num_vertex = %d, decimed_vertex = %d\n", pgsalt->num_vertex, pgsalt->decimed_vertex);
@@ -430,6 +1013,7 @@ int gsalt_query_numvertex(GSalt gsalt) {
 
 int gsalt_query_numtriangles(GSalt gsalt) {
 	check_gsalt;
+	check_async;
 	gsalt_log(gsalt_verbose_debug, "GSalt: query numtriangles\n");
 
 	gsalt_log(gsalt_verbose_debug, "GSalt: num_triangles = %d, decimed_triangles = %d\n", pgsalt->num_triangles, pgsalt->decimed_triangles);
@@ -437,9 +1021,48 @@ int gsalt_query_numtriangles(GSalt gsalt) {
 	return (pgsalt->decimed_triangles)?pgsalt->decimed_triangles:pgsalt->num_triangles;
 }
 
+gslat_return gsalt_query_error(GSalt gsalt, float *max_error, float *rms_error) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query error, max = %g, rms = %g\n", pgsalt->decimed_error, pgsalt->decimed_rms);
+
+	if(max_error) *max_error = pgsalt->decimed_error;
+	if(rms_error) *rms_error = pgsalt->decimed_rms;
+	return GSALT_OK;
+}
+
+gslat_return gsalt_query_bounds(GSalt gsalt, float *bbox_min, float *bbox_max, float *center, float *radius) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query bounds\n");
+
+	if(pgsalt->radius<0.0f) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query bounds but model is not simplified\n");
+		return GSALT_ERROR;
+	}
+
+	for (int k=0; k<3; k++) {
+		if(bbox_min) bbox_min[k] = pgsalt->bbox_min[k];
+		if(bbox_max) bbox_max[k] = pgsalt->bbox_max[k];
+		if(center) center[k] = pgsalt->center[k];
+	}
+	if(radius) *radius = pgsalt->radius;
+	return GSALT_OK;
+}
+
+gslat_return gsalt_query_stats(GSalt gsalt, gsalt_stats *stats) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query stats\n");
+
+	if(stats) *stats = pgsalt->stats;
+	return GSALT_OK;
+}
+
 gslat_return gsalt_query_color(GSalt gsalt, int index, float *r, float *g, float *b, float *a) {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: query color(%d)\n", index);
+	check_async;
+	gsalt_log_all("GSalt: query color(%d)\n", index);
 
 	if(!(pgsalt->flags&GSALT_COLOR)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: query color but color is not activated\n");		
@@ -451,22 +1074,25 @@ gslat_return gsalt_query_color(GSalt gsalt, int index, float *r, float *g, float
 	}
 
 	if(pgsalt->decimed_vertex) {
-		float* color = pgsalt->color.ptr+index*pgsalt->color.stride;
+		float color[4];
+		gsalt_decode(color, 4, 4, pgsalt->color.ptr+index*pgsalt->color.stride, 0, pgsalt->color.type, pgsalt->color.size, 1);
 		if(r) *r=color[0];
 		if(g) *g=color[1];
 		if(b) *b=color[2];
 		if(a) *a=color[3];
 	} else {
-		if(r) *r=pgsalt->model->color(index).R();
-		if(g) *g=pgsalt->model->color(index).G();
-		if(b) *b=pgsalt->model->color(index).B();
-		if(a) *a=pgsalt->model->color(index).A();
+		unsigned int v = model_index(pgsalt, index);
+		if(r) *r=pgsalt->model->color(v).R();
+		if(g) *g=pgsalt->model->color(v).G();
+		if(b) *b=pgsalt->model->color(v).B();
+		if(a) *a=pgsalt->model->color(v).A();
 	}
 	return GSALT_OK;
 }
 gslat_return gsalt_query_normal(GSalt gsalt, int index, float *x, float *y, float *z)  {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: query normal(%d)\n", index);
+	check_async;
+	gsalt_log_all("GSalt: query normal(%d)\n", index);
 
 	if(!(pgsalt->flags&GSALT_NORMAL)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: query normal but normal is not activated\n");		
@@ -478,20 +1104,23 @@ gslat_return gsalt_query_normal(GSalt gsalt, int index, float *x, float *y, floa
 	}
 
 	if(pgsalt->decimed_vertex) {
-		float* normal = pgsalt->normal.ptr+index*pgsalt->normal.stride;
+		float normal[4];
+		gsalt_decode(normal, 4, 3, pgsalt->normal.ptr+index*pgsalt->normal.stride, 0, pgsalt->normal.type, pgsalt->normal.size, 1);
 		if(x) *x=normal[0];
 		if(y) *y=normal[1];
 		if(z) *z=normal[2];
 	} else {
-		if(x) *x=pgsalt->model->normal(index)[0];
-		if(y) *y=pgsalt->model->normal(index)[1];
-		if(z) *z=pgsalt->model->normal(index)[2];
+		unsigned int v = model_index(pgsalt, index);
+		if(x) *x=pgsalt->model->normal(v)[0];
+		if(y) *y=pgsalt->model->normal(v)[1];
+		if(z) *z=pgsalt->model->normal(v)[2];
 	}
 	return GSALT_OK;
 }
 gslat_return gsalt_query_texcoord(GSalt gsalt, int index, float *s, float *t, float *r, float *q) {
 	check_gsalt;
-	gsalt_log(gsalt_verbose_all, "GSalt: query texcoord(%d)\n", index);
+	check_async;
+	gsalt_log_all("GSalt: query texcoord(%d)\n", index);
 
 	if(!(pgsalt->flags&GSALT_TEXCOORD)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: query texcoord but texcoord is not activated\n");		
@@ -503,14 +1132,16 @@ gslat_return gsalt_query_texcoord(GSalt gsalt, int index, float *s, float *t, fl
 	}
 
 	if(pgsalt->decimed_vertex) {
-		float* texcoord = pgsalt->texcoord.ptr+index*pgsalt->texcoord.stride;
+		float texcoord[4];
+		gsalt_decode(texcoord, 4, 2, pgsalt->texcoord.ptr+index*pgsalt->texcoord.stride, 0, pgsalt->texcoord.type, pgsalt->texcoord.size, 1);
 		if(s) *s=texcoord[0];
 		if(t) *t=texcoord[1];
 		if(r) *r=0.0f;
 		if(q) *q=1.0f;
 	} else {
-		if(s) *s=pgsalt->model->texcoord(index).u[0];
-		if(t) *t=pgsalt->model->texcoord(index).u[1];
+		unsigned int v = model_index(pgsalt, index);
+		if(s) *s=pgsalt->model->texcoord(v).u[0];
+		if(t) *t=pgsalt->model->texcoord(v).u[1];
 		if(r) *r=0.0f;
 		if(q) *q=1.0f;
 	}
@@ -518,6 +1149,7 @@ gslat_return gsalt_query_texcoord(GSalt gsalt, int index, float *s, float *t, fl
 }
 gslat_return gsalt_query_vertex(GSalt gsalt, int index, float *x, float *y, float *z, float *w) {
 	check_gsalt;
+	check_async;
 
 	if (index<0 || index>((pgsalt->decimed_vertex)?pgsalt->decimed_vertex:pgsalt->num_vertex)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: query vertex index out of range\n");		
@@ -525,23 +1157,26 @@ gslat_return gsalt_query_vertex(GSalt gsalt, int index, float *x, float *y, floa
 	}
 
 	if(pgsalt->decimed_vertex) {
-		float* vertex = pgsalt->vertex.ptr+index*pgsalt->vertex.stride;
+		float vertex[4];
+		gsalt_decode(vertex, 4, 3, pgsalt->vertex.ptr+index*pgsalt->vertex.stride, 0, pgsalt->vertex.type, pgsalt->vertex.size, 1);
 		if(x) *x=vertex[0];
 		if(y) *y=vertex[1];
 		if(z) *z=vertex[2];
 		if(w) *w=1.0f;
 	} else {
-		if(x) *x=pgsalt->model->vertex(index).as.pos[0];
-		if(y) *y=pgsalt->model->vertex(index).as.pos[1];
-		if(z) *z=pgsalt->model->vertex(index).as.pos[2];
+		unsigned int v = model_index(pgsalt, index);
+		if(x) *x=pgsalt->model->vertex(v).as.pos[0];
+		if(y) *y=pgsalt->model->vertex(v).as.pos[1];
+		if(z) *z=pgsalt->model->vertex(v).as.pos[2];
 		if(w) *w=1.0f;
 	}
-	gsalt_log(gsalt_verbose_all, "GSalt: query vertex(%d) ->(%f, %f, %f)\n", index, *x, *y, *z);
+	gsalt_log_all("GSalt: query vertex(%d) ->(%f, %f, %f)\n", index, *x, *y, *z);
 	return GSALT_OK;
 }
 
 gslat_return gsalt_query_triangle_uint32(GSalt gsalt, int index, uint32_t *idx1, uint32_t *idx2, uint32_t *idx3) {
 	check_gsalt;
+	check_async;
 	if(!(pgsalt->faces_defined)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: query triangle index but texcoord is not activated\n");		
 		return GSALT_ERROR;
@@ -565,16 +1200,19 @@ gslat_return gsalt_query_triangle_uint32(GSalt gsalt, int index, uint32_t *idx1,
 			if(idx3) *idx3=triangle[2];
 		}
 	} else {
-		if(idx1) *idx1=pgsalt->model->face(index).v[0];
-		if(idx2) *idx2=pgsalt->model->face(index).v[1];
-		if(idx3) *idx3=pgsalt->model->face(index).v[2];
+		uint32_t v[3];
+		given_face(pgsalt, index, v);
+		if(idx1) *idx1=v[0];
+		if(idx2) *idx2=v[1];
+		if(idx3) *idx3=v[2];
 	}
-	gsalt_log(gsalt_verbose_all, "GSalt: query triangle uint32_t (%d) -> (%d, %d, %d)\n", index, *idx1, *idx2, *idx3);
+	gsalt_log_all("GSalt: query triangle uint32_t (%d) -> (%d, %d, %d)\n", index, *idx1, *idx2, *idx3);
 	return GSALT_OK;
 }
 
 gslat_return gsalt_query_triangle_uint16(GSalt gsalt, int index, uint16_t *idx1, uint16_t *idx2, uint16_t *idx3)  {
 	check_gsalt;
+	check_async;
 	if(!(pgsalt->faces_defined)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: query triangle index but texcoord is not activated\n");		
 		return GSALT_ERROR;
@@ -598,121 +1236,475 @@ gslat_return gsalt_query_triangle_uint16(GSalt gsalt, int index, uint16_t *idx1,
 			if(idx3) *idx3=triangle[2];
 		}
 	} else {
-		if(idx1) *idx1=pgsalt->model->face(index).v[0];
-		if(idx2) *idx2=pgsalt->model->face(index).v[1];
-		if(idx3) *idx3=pgsalt->model->face(index).v[2];
+		uint32_t v[3];
+		given_face(pgsalt, index, v);
+		if(idx1) *idx1=v[0];
+		if(idx2) *idx2=v[1];
+		if(idx3) *idx3=v[2];
+	}
+	gsalt_log_all("GSalt: query triangle uint16_t (%d) -> (%d, %d, %d)\n", index, *idx1, *idx2, *idx3);
+	return GSALT_OK;
+}
+
+// bulk read back
+static int check_range(PGSalt pgsalt, const char* what, int first, int count, int total)
+{
+	if (first<0 || count<0 || first+count>total) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query %s range (%d, %d) out of range\n", what, first, count);
+		return 0;
+	}
+	return 1;
+}
+
+gslat_return gsalt_query_vertices(GSalt gsalt, float *dst, int stride, int first, int count) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query vertices (%d, %d)\n", first, count);
+
+	if (!check_range(pgsalt, "vertices", first, count, (pgsalt->decimed_vertex)?pgsalt->decimed_vertex:pgsalt->num_vertex))
+		return GSALT_ERROR;
+
+	if(pgsalt->decimed_vertex) {
+		gsalt_decode(dst, stride?stride:3, 3, pgsalt->vertex.ptr+first*pgsalt->vertex.stride, pgsalt->vertex.stride, pgsalt->vertex.type, pgsalt->vertex.size, count);
+	} else {
+		if (!stride) stride = 3;
+		for (int i=first; i<first+count; i++, dst+=stride) {
+			unsigned int v = model_index(pgsalt, i);
+			dst[0] = pgsalt->model->vertex(v).as.pos[0];
+			dst[1] = pgsalt->model->vertex(v).as.pos[1];
+			dst[2] = pgsalt->model->vertex(v).as.pos[2];
+		}
+	}
+	return GSALT_OK;
+}
+
+gslat_return gsalt_query_normals(GSalt gsalt, float *dst, int stride, int first, int count) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query normals (%d, %d)\n", first, count);
+
+	if(!(pgsalt->flags&GSALT_NORMAL)) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query normals but normal is not activated\n");
+		return GSALT_ERROR;
+	}
+	if (!check_range(pgsalt, "normals", first, count, (pgsalt->decimed_vertex)?pgsalt->decimed_vertex:pgsalt->num_vertex))
+		return GSALT_ERROR;
+
+	if(pgsalt->decimed_vertex) {
+		gsalt_decode(dst, stride?stride:3, 3, pgsalt->normal.ptr+first*pgsalt->normal.stride, pgsalt->normal.stride, pgsalt->normal.type, pgsalt->normal.size, count);
+	} else {
+		if (!stride) stride = 3;
+		for (int i=first; i<first+count; i++, dst+=stride) {
+			unsigned int v = model_index(pgsalt, i);
+			dst[0] = pgsalt->model->normal(v)[0];
+			dst[1] = pgsalt->model->normal(v)[1];
+			dst[2] = pgsalt->model->normal(v)[2];
+		}
 	}
-	gsalt_log(gsalt_verbose_all, "GSalt: query triangle uint16_t (%d) -> (%d, %d, %d)\n", index, *idx1, *idx2, *idx3);
+	return GSALT_OK;
+}
+
+gslat_return gsalt_query_colors(GSalt gsalt, float *dst, int stride, int first, int count) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query colors (%d, %d)\n", first, count);
+
+	if(!(pgsalt->flags&GSALT_COLOR)) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query colors but color is not activated\n");
+		return GSALT_ERROR;
+	}
+	if (!check_range(pgsalt, "colors", first, count, (pgsalt->decimed_vertex)?pgsalt->decimed_vertex:pgsalt->num_vertex))
+		return GSALT_ERROR;
+
+	if(pgsalt->decimed_vertex) {
+		gsalt_decode(dst, stride?stride:4, 4, pgsalt->color.ptr+first*pgsalt->color.stride, pgsalt->color.stride, pgsalt->color.type, pgsalt->color.size, count);
+	} else {
+		if (!stride) stride = 4;
+		for (int i=first; i<first+count; i++, dst+=stride) {
+			unsigned int v = model_index(pgsalt, i);
+			dst[0] = pgsalt->model->color(v).R();
+			dst[1] = pgsalt->model->color(v).G();
+			dst[2] = pgsalt->model->color(v).B();
+			dst[3] = pgsalt->model->color(v).A();
+		}
+	}
+	return GSALT_OK;
+}
+
+gslat_return gsalt_query_texcoords(GSalt gsalt, float *dst, int stride, int first, int count) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query texcoords (%d, %d)\n", first, count);
+
+	if(!(pgsalt->flags&GSALT_TEXCOORD)) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query texcoords but texcoord is not activated\n");
+		return GSALT_ERROR;
+	}
+	if (!check_range(pgsalt, "texcoords", first, count, (pgsalt->decimed_vertex)?pgsalt->decimed_vertex:pgsalt->num_vertex))
+		return GSALT_ERROR;
+
+	if(pgsalt->decimed_vertex) {
+		gsalt_decode(dst, stride?stride:2, 2, pgsalt->texcoord.ptr+first*pgsalt->texcoord.stride, pgsalt->texcoord.stride, pgsalt->texcoord.type, pgsalt->texcoord.size, count);
+	} else {
+		if (!stride) stride = 2;
+		for (int i=first; i<first+count; i++, dst+=stride) {
+			unsigned int v = model_index(pgsalt, i);
+			dst[0] = pgsalt->model->texcoord(v).u[0];
+			dst[1] = pgsalt->model->texcoord(v).u[1];
+		}
+	}
+	return GSALT_OK;
+}
+
+#define query_triangles(T, OT) \
+	check_gsalt; \
+	check_async; \
+	gsalt_log(gsalt_verbose_debug, "GSalt: query triangles " #T " (%d, %d)\n", first, count); \
+	if(!(pgsalt->faces_defined)) { \
+		gsalt_log(gsalt_verbose_debug, "GSalt: query triangles but there is no indexes\n"); \
+		return GSALT_ERROR; \
+	} \
+	if (!check_range(pgsalt, "triangles", first, count, (pgsalt->decimed_triangles)?pgsalt->decimed_triangles:pgsalt->num_triangles)) \
+		return GSALT_ERROR; \
+	if(pgsalt->decimed_triangles) { \
+		int stride = pgsalt->indexes.stride*3; \
+		if(pgsalt->indexes.type==(sizeof(T)==sizeof(uint16_t)) && stride==3) \
+			memcpy(dst, pgsalt->indexes.ptr.OT+first*3, sizeof(T)*count*3); \
+		else if(pgsalt->indexes.type) { \
+			const uint16_t *src = pgsalt->indexes.ptr.ui16+first*stride; \
+			for (int i=0; i<count; i++, src+=stride, dst+=3) { \
+				dst[0] = (T)src[0]; dst[1] = (T)src[1]; dst[2] = (T)src[2]; \
+			} \
+		} else { \
+			const uint32_t *src = pgsalt->indexes.ptr.ui32+first*stride; \
+			for (int i=0; i<count; i++, src+=stride, dst+=3) { \
+				dst[0] = (T)src[0]; dst[1] = (T)src[1]; dst[2] = (T)src[2]; \
+			} \
+		} \
+	} else { \
+		uint32_t v[3]; \
+		for (int i=first; i<first+count; i++, dst+=3) { \
+			given_face(pgsalt, i, v); \
+			dst[0] = (T)v[0]; dst[1] = (T)v[1]; dst[2] = (T)v[2]; \
+		} \
+	} \
+	return GSALT_OK
+
+gslat_return gsalt_query_triangles_uint32(GSalt gsalt, uint32_t *dst, int first, int count) {
+	query_triangles(uint32_t, ui32);
+}
+
+gslat_return gsalt_query_triangles_uint16(GSalt gsalt, uint16_t *dst, int first, int count) {
+	query_triangles(uint16_t, ui16);
+}
+#undef query_triangles
+
+gslat_return gsalt_query_quantized(GSalt gsalt, uint16_t *positions, int16_t *normals, uint16_t *texcoords, int first, int count, gsalt_quant_params *params) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query quantized (%d, %d)\n", first, count);
+
+	if(pgsalt->radius<0.0f || !pgsalt->decimed_vertex) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query quantized but model is not simplified\n");
+		return GSALT_ERROR;
+	}
+	if((normals && !(pgsalt->flags&GSALT_NORMAL)) || (texcoords && !(pgsalt->flags&GSALT_TEXCOORD))) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query quantized attribute that is not activated\n");
+		return GSALT_ERROR;
+	}
+	if (!check_range(pgsalt, "quantized", first, count, pgsalt->decimed_vertex))
+		return GSALT_ERROR;
+
+	// the ranges come from the output pass
+	float pos_inv[3], uv_inv[2];
+	for (int k=0; k<3; k++) {
+		float extent = pgsalt->bbox_max[k]-pgsalt->bbox_min[k];
+		pos_inv[k] = (extent>0.0f)?65535.0f/extent:0.0f;
+		if(params) {
+			params->position_offset[k] = pgsalt->bbox_min[k];
+			params->position_scale[k] = extent/65535.0f;
+		}
+	}
+	for (int k=0; k<2; k++) {
+		float extent = pgsalt->uv_max[k]-pgsalt->uv_min[k];
+		uv_inv[k] = (extent>0.0f)?65535.0f/extent:0.0f;
+		if(params) {
+			params->texcoord_offset[k] = pgsalt->uv_min[k];
+			params->texcoord_scale[k] = extent/65535.0f;
+		}
+	}
+
+	float block[GSALT_BLOCK*3];
+	for (int i=first; i<first+count; i+=GSALT_BLOCK) {
+		int n = (first+count-i<GSALT_BLOCK)?(first+count-i):GSALT_BLOCK;
+		if(positions) {
+			gsalt_decode(block, 3, 3, pgsalt->vertex.ptr+i*pgsalt->vertex.stride, pgsalt->vertex.stride, pgsalt->vertex.type, pgsalt->vertex.size, n);
+			uint16_t *d = positions+(i-first)*4;
+			gsalt_quantize_unorm16(d, 4, 3, block, 3, pgsalt->bbox_min, pos_inv, n);
+			for (int j=0; j<n; j++)
+				d[j*4+3] = 0;
+		}
+		if(normals) {
+			gsalt_decode(block, 3, 3, pgsalt->normal.ptr+i*pgsalt->normal.stride, pgsalt->normal.stride, pgsalt->normal.type, pgsalt->normal.size, n);
+			gsalt_encode_oct16(normals+(i-first)*2, 2, block, 3, n);
+		}
+		if(texcoords) {
+			gsalt_decode(block, 2, 2, pgsalt->texcoord.ptr+i*pgsalt->texcoord.stride, pgsalt->texcoord.stride, pgsalt->texcoord.type, pgsalt->texcoord.size, n);
+			gsalt_quantize_unorm16(texcoords+(i-first)*2, 2, 2, block, 2, pgsalt->uv_min, uv_inv, n);
+		}
+	}
+	return GSALT_OK;
+}
+
+int gsalt_query_triangles_varint(GSalt gsalt, uint8_t *dst, int size) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: query triangles varint\n");
+
+	if(!(pgsalt->faces_defined) || !pgsalt->decimed_triangles) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: query triangles varint but there is no simplified indexes\n");
+		return GSALT_ERROR;
+	}
+	// a block of triangles at a time, through gsalt_query_triangles_uint32 for the index width and stride
+	uint32_t tris[GSALT_BLOCK*3];
+	uint8_t bytes[GSALT_BLOCK*3*5];	// 5 bytes at most per index
+	uint32_t prev = 0;
+	size_t len = 0;
+	for (int first=0; first<pgsalt->decimed_triangles; first+=GSALT_BLOCK) {
+		int count = (pgsalt->decimed_triangles-first<GSALT_BLOCK)?(pgsalt->decimed_triangles-first):GSALT_BLOCK;
+		gsalt_query_triangles_uint32(gsalt, tris, first, count);
+		size_t n = gsalt_encode_varint(dst?bytes:NULL, tris, count*3, &prev);
+		if(dst) {
+			if(len+n>(size_t)size) {
+				gsalt_log(gsalt_verbose_debug, "GSalt: query triangles varint, buffer too small (%d)\n", size);
+				return GSALT_ERROR;
+			}
+			memcpy(dst+len, bytes, n);
+		}
+		len += n;
+	}
+	return (int)len;
+}
+
+int gsalt_decode_triangles_varint(const uint8_t *src, int size, uint32_t *dst, int count) {
+	size_t len = gsalt_decode_varint(dst, count, src, size);
+	if(!len && count) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: decode triangles varint, stream too short (%d)\n", size);
+		return GSALT_ERROR;
+	}
+	return (int)len;
+}
+
+gslat_return gsalt_save_file(GSalt gsalt, const char *filename, int format) {
+	check_gsalt;
+	check_async;
+	gsalt_log(gsalt_verbose_debug, "GSalt: Save file %s, format %d\n", (filename)?filename:"(null)", format);
+
+	if(!pgsalt->decimed_vertex || !pgsalt->decimed_triangles) {
+		gsalt_log(gsalt_verbose_error, "GSalt: save file but model is not simplified\n");
+		return GSALT_ERROR;
+	}
+	if(format!=GSALT_FILE_PLY && format!=GSALT_FILE_STL && format!=GSALT_FILE_OBJ) {
+		gsalt_log(gsalt_verbose_error, "GSalt: save file, unknown format %d\n", format);
+		return GSALT_ERROR;
+	}
+	double t0 = gsalt_time();
+	gsalt_array_view arrays[4];
+	fpointer *src[4] = {&pgsalt->vertex, &pgsalt->color, &pgsalt->normal, &pgsalt->texcoord};
+	unsigned int flags[4] = {GSALT_VERTEX, GSALT_COLOR, GSALT_NORMAL, GSALT_TEXCOORD};
+	for (int k=0; k<4; k++) {
+		arrays[k].ptr = (k==0 || (pgsalt->flags&flags[k]))?src[k]->ptr:NULL;
+		arrays[k].type = src[k]->type;
+		arrays[k].size = src[k]->size;
+		arrays[k].stride = src[k]->stride;
+	}
+	// without indexes, the simplified vertex are a flat list of triangles
+	const void *indexes = (pgsalt->faces_defined)?pgsalt->indexes.ptr.ptr:NULL;
+	if(!filename || !gsalt_write_mesh(filename, format, pgsalt->decimed_vertex, arrays, pgsalt->decimed_triangles, indexes, pgsalt->indexes.type, pgsalt->indexes.stride)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot write \"%s\"\n", (filename)?filename:"(null)");
+		return GSALT_ERROR;
+	}
+	gsalt_trace_complete("gsalt_save_file", t0, gsalt_time());
 	return GSALT_OK;
 }
 
 // v0.2 api
+static void ingest_done(PGSalt pgsalt, const char *name, double t0)
+{
+	double t1 = gsalt_time();
+	pgsalt->stats.time_ingest += t1-t0;
+	gsalt_trace_complete(name, t0, t1);
+}
+
+// feed the model with count triangles (3 indexes each)
+static void ingest_faces(PGSalt pgsalt, multiptr array, int tp, int count)
+{
+	int idx1, idx2, idx3;
+	for (int i=0; i<count; i++) {
+		idx1 = (tp)?array.ui16[0]:array.ui32[0];
+		idx2 = (tp)?array.ui16[1]:array.ui32[1];
+		idx3 = (tp)?array.ui16[2]:array.ui32[2];
+		pgsalt->model->add_face(idx1, idx2, idx3);
+		if(tp)
+			array.ui16+=3;
+		else
+			array.ui32+=3;
+	}
+}
+
+// feed the model from num elements of the arrays (NULL for the ones not given), a block of vertex at a time
+static void ingest(PGSalt pgsalt, int num, fpointer *vertex, fpointer *color, fpointer *normal, fpointer *texcoord)
+{
+	float v[GSALT_BLOCK*3], c[GSALT_BLOCK*4], n[GSALT_BLOCK*3], t[GSALT_BLOCK*2];
+	for (int first=0; first<num; first+=GSALT_BLOCK) {
+		int count = (num-first<GSALT_BLOCK)?(num-first):GSALT_BLOCK;
+#define decode(A, B, N) if(A) gsalt_decode(B, N, N, A->ptr+first*A->stride, A->stride, A->type, A->size, count)
+		decode(vertex, v, 3);
+		decode(color, c, 4);
+		decode(normal, n, 3);
+		decode(texcoord, t, 2);
+#undef decode
+		for (int i=0; i<count; i++) {
+			if(vertex) pgsalt->model->add_vertex(v[i*3+0], v[i*3+1], v[i*3+2]);
+			if(color) pgsalt->model->add_color(c[i*4+0], c[i*4+1], c[i*4+2], c[i*4+3]);
+			if(normal) pgsalt->model->add_normal(n[i*3+0], n[i*3+1], n[i*3+2]);
+			if(texcoord) pgsalt->model->add_texcoord(t[i*2+0], t[i*2+1]);
+		}
+	}
+}
+
 gslat_return gsalt_array_vertex(GSalt gsalt, int type, int size, int stride, void* pointer)
 {
-	if (type!=GSALT_FLOAT) {
-		gsalt_log(gsalt_verbose_error, "GSalt: Array vertex only support FLOAT (type=%d)\n", type);
+	if (!gsalt_type_valid(type, size)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Array vertex type %d with size %d is not supported\n", type, size);
 		return GSALT_ERROR;
 	}
 	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
 
-	gsalt_log(gsalt_verbose_debug, "GSalt: Array vertex defined (%s, %d, %d)\n", "FLOAT", size, stride);
-	init_pointer(&pgsalt->vertex, (float*)pointer, size, stride, 0);
+	gsalt_log(gsalt_verbose_debug, "GSalt: Array vertex defined (%d, %d, %d)\n", type, size, stride);
+	init_pointer(&pgsalt->vertex, pointer, type, size, stride*gsalt_type_bytes(type), 0);
 
-	float x=0, y=0, z=0/*, w=1*/;
-	int sz = pgsalt->vertex.size;
-	int width = pgsalt->vertex.stride;
-	float* array = pgsalt->vertex.ptr;
-	for (int i=0; i<pgsalt->num_vertex; i++) {
-		if (sz>0) x = array[0];
-		if (sz>1) y = array[1];
-		if (sz>2) z = array[2];
-		//if (sz>3) w = array[3];
-		pgsalt->model->add_vertex(x, y, z);
-		array+=width;
-	}
+	ingest(pgsalt, pgsalt->num_vertex, &pgsalt->vertex, NULL, NULL, NULL);
+	ingest_done(pgsalt, "gsalt_array_vertex", t0);
+	return GSALT_OK;
 }
 
 gslat_return gsalt_array_normal(GSalt gsalt, int type, int stride, void* pointer) {
-	if (type!=GSALT_FLOAT) {
-		gsalt_log(gsalt_verbose_error, "GSalt: Array normal only support FLOAT (type=%d)\n", type);
+	if (!gsalt_type_valid(type, 3)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Array normal type %d is not supported\n", type);
 		return GSALT_ERROR;
 	}
 	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
 	if(!(pgsalt->flags&GSALT_NORMAL)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: Setting Array normal but normal is not activated\n");		
 		return GSALT_ERROR;
 	}
 
-	gsalt_log(gsalt_verbose_debug, "GSalt: Array normal defined (%s, %d)\n", "FLOAT", stride);
-	init_pointer(&pgsalt->normal, (float*)pointer, 3, stride, 0);
+	gsalt_log(gsalt_verbose_debug, "GSalt: Array normal defined (%d, %d)\n", type, stride);
+	init_pointer(&pgsalt->normal, pointer, type, 3, stride*gsalt_type_bytes(type), 0);
 
-	float x=0, y=0, z=0;
-	int sz = pgsalt->normal.size;
-	int width = pgsalt->normal.stride;
-	float* array = pgsalt->normal.ptr;
-	for (int i=0; i<pgsalt->num_vertex; i++) {
-		if (sz>0) x = array[0];
-		if (sz>1) y = array[1];
-		if (sz>2) z = array[2];
-		pgsalt->model->add_normal(x, y, z);
-		array+=width;
-	}
+	ingest(pgsalt, pgsalt->num_vertex, NULL, NULL, &pgsalt->normal, NULL);
+	ingest_done(pgsalt, "gsalt_array_normal", t0);
+	return GSALT_OK;
 }
 
 gslat_return gsalt_array_color(GSalt gsalt, int type, int size, int stride, void* pointer) {
-	if (type!=GSALT_FLOAT) {
-		gsalt_log(gsalt_verbose_error, "GSalt: Array color only support FLOAT (type=%d)\n", type);
+	if (!gsalt_type_valid(type, size)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Array color type %d with size %d is not supported\n", type, size);
 		return GSALT_ERROR;
 	}
 	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
 	if(!(pgsalt->flags&GSALT_COLOR)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: Setting Array color but color is not activated\n");		
 		return GSALT_ERROR;
 	}
 
-	gsalt_log(gsalt_verbose_debug, "GSalt: Array color defined (%s, %d, %d)\n", "FLOAT", size, stride);
-	init_pointer(&pgsalt->color, (float*)pointer, size, stride, 0);
+	gsalt_log(gsalt_verbose_debug, "GSalt: Array color defined (%d, %d, %d)\n", type, size, stride);
+	init_pointer(&pgsalt->color, pointer, type, size, stride*gsalt_type_bytes(type), 0);
 
-	float r=0, g=0, b=0, a=1;
-	int sz = pgsalt->color.size;
-	int width = pgsalt->color.stride;
-	float* array = pgsalt->color.ptr;
-	for (int i=0; i<pgsalt->num_vertex; i++) {
-		if (sz>0) r = array[0];
-		if (sz>1) g = array[1];
-		if (sz>2) b = array[2];
-		if (sz>3) a = array[3];
-		pgsalt->model->add_color(r, g, b, a);
-		array+=width;
-	}
+	ingest(pgsalt, pgsalt->num_vertex, NULL, &pgsalt->color, NULL, NULL);
+	ingest_done(pgsalt, "gsalt_array_color", t0);
+	return GSALT_OK;
 }
 
 gslat_return gsalt_array_texcoord(GSalt gsalt, int type, int size, int stride, void* pointer) {
-	if (type!=GSALT_FLOAT) {
-		gsalt_log(gsalt_verbose_error, "GSalt: Array texcoord only support FLOAT (type=%d)\n", type);
+	if (!gsalt_type_valid(type, size)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Array texcoord type %d with size %d is not supported\n", type, size);
 		return GSALT_ERROR;
 	}
 	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
 	if(!(pgsalt->flags&GSALT_TEXCOORD)) {
 		gsalt_log(gsalt_verbose_debug, "GSalt: Setting Array texcoord but texcoord is not activated\n");		
 		return GSALT_ERROR;
 	}
 
-	gsalt_log(gsalt_verbose_debug, "GSalt: Array texcoord defined (%s, %d, %d)\n", "FLOAT", size, stride);
-	init_pointer(&pgsalt->texcoord, (float*)pointer, size, stride, 0);
+	gsalt_log(gsalt_verbose_debug, "GSalt: Array texcoord defined (%d, %d, %d)\n", type, size, stride);
+	init_pointer(&pgsalt->texcoord, pointer, type, size, stride*gsalt_type_bytes(type), 0);
+
+	ingest(pgsalt, pgsalt->num_vertex, NULL, NULL, NULL, &pgsalt->texcoord);
+	ingest_done(pgsalt, "gsalt_array_texcoord", t0);
+	return GSALT_OK;
+}
+
+gslat_return gsalt_array_interleaved(GSalt gsalt, const gsalt_attrib_desc *descs, int n, int stride, void* pointer) {
+	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
+	gsalt_log(gsalt_verbose_debug, "GSalt: Array interleaved defined (%d attributes, stride %d)\n", n, stride);
+
+	if (stride<=0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: Array interleaved stride (%d) is not valid\n", stride);
+		return GSALT_ERROR;
+	}
+	for (int k=0; k<n; k++) {
+		const gsalt_attrib_desc *d = descs+k;
+		int size = (d->attrib==GSALT_NORMAL)?3:d->size;
+		if (!gsalt_type_valid(d->type, size)) {
+			gsalt_log(gsalt_verbose_error, "GSalt: Array interleaved type %d with size %d is not supported\n", d->type, size);
+			return GSALT_ERROR;
+		}
+		if (d->offset<0 || (d->offset%gsalt_type_bytes(d->type)) || d->offset+gsalt_element_bytes(d->type, size)>stride) {
+			gsalt_log(gsalt_verbose_error, "GSalt: Array interleaved offset (%d) does not fit the stride\n", d->offset);
+			return GSALT_ERROR;
+		}
+		if (d->attrib!=GSALT_VERTEX && d->attrib!=GSALT_COLOR && d->attrib!=GSALT_NORMAL && d->attrib!=GSALT_TEXCOORD) {
+			gsalt_log(gsalt_verbose_error, "GSalt: Array interleaved unknown attribute %x\n", d->attrib);
+			return GSALT_ERROR;
+		}
+		if (d->attrib!=GSALT_VERTEX && !(pgsalt->flags&d->attrib)) {
+			gsalt_log(gsalt_verbose_debug, "GSalt: Setting Array interleaved but attribute %x is not activated\n", d->attrib);
+			return GSALT_ERROR;
+		}
+	}
 
-	float s=0, t=0/*, r=0, q=1*/;
-	int sz = pgsalt->texcoord.size;
-	int width = pgsalt->texcoord.stride;
-	float* array = pgsalt->texcoord.ptr;
-	for (int i=0; i<pgsalt->num_vertex; i++) {
-		if (sz>0) s = array[0];
-		if (sz>1) t = array[1];
-		/*if (sz>2) r = array[2];
-		if (sz>3) q = array[3];*/
-		pgsalt->model->add_texcoord(s, t);
-		array+=width;
+	pgsalt->interleaved = (char*)pointer;
+	pgsalt->interleaved_stride = stride;
+	fpointer *vertex = NULL, *color = NULL, *normal = NULL, *texcoord = NULL;
+	for (int k=0; k<n; k++) {
+		const gsalt_attrib_desc *d = descs+k;
+		fpointer *p;
+		switch (d->attrib) {
+			case GSALT_VERTEX: p = vertex = &pgsalt->vertex; break;
+			case GSALT_COLOR: p = color = &pgsalt->color; break;
+			case GSALT_NORMAL: p = normal = &pgsalt->normal; break;
+			default: p = texcoord = &pgsalt->texcoord; break;
+		}
+		init_pointer(p, (char*)pointer+d->offset, d->type, (d->attrib==GSALT_NORMAL)?3:d->size, stride, 0);
+		p->interleaved = 1;
 	}
+
+	// all the attributes of a block of vertex are read together, so the buffer is walked once
+	ingest(pgsalt, pgsalt->num_vertex, vertex, color, normal, texcoord);
+	ingest_done(pgsalt, "gsalt_array_interleaved", t0);
+	return GSALT_OK;
 }
 
 gslat_return gsalt_array_indexes(GSalt gsalt, int type, void* pointer) {
@@ -721,23 +1713,168 @@ gslat_return gsalt_array_indexes(GSalt gsalt, int type, void* pointer) {
 		return GSALT_ERROR;
 	}
 	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
 
 	gsalt_log(gsalt_verbose_debug, "GSalt: Array indexes defined (%s)\n", (type)?"UINT16":"UINT32");
 	init_pointer(&pgsalt->indexes, pointer, 1, 0, 0, type);
 
 	pgsalt->faces_defined=pgsalt->num_triangles;
 
-	int idx1, idx2, idx3;
-	multiptr array = pgsalt->indexes.ptr;
-	int tp = pgsalt->indexes.type;
-	for (int i=0; i<pgsalt->num_triangles; i++) {
-		idx1 = (tp)?array.ui16[0]:array.ui32[0];
-		idx2 = (tp)?array.ui16[1]:array.ui32[1];
-		idx3 = (tp)?array.ui16[2]:array.ui32[2];
-		pgsalt->model->add_face(idx1, idx2, idx3);
-		if(tp)
-			array.ui16+=3;
-		else
-			array.ui32+=3;
+	ingest_faces(pgsalt, pgsalt->indexes.ptr, pgsalt->indexes.type, pgsalt->num_triangles);
+	ingest_done(pgsalt, "gsalt_array_indexes", t0);
+	return GSALT_OK;
+}
+
+// streaming api: chunks of the arrays, copied in the model as they come
+static int check_chunk(PGSalt pgsalt, const char *what, int first, int count, int given, int total)
+{
+	if (first!=given) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s chunk starts at %d, expected %d (chunks must come in order)\n", what, first, given);
+		return 0;
+	}
+	if (count<0 || first+count>total) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s chunk (%d, %d) goes past %d\n", what, first, count, total);
+		return 0;
+	}
+	return 1;
+}
+
+static gslat_return add_chunk(GSalt gsalt, unsigned int attrib, const char *name, const char *func, int first, int count, int type, int size, int stride, const void* pointer)
+{
+	if (!gsalt_type_valid(type, size)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s chunk type %d with size %d is not supported\n", name, type, size);
+		return GSALT_ERROR;
+	}
+	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
+	gsalt_log(gsalt_verbose_debug, "GSalt: %s chunk (%d, %d)\n", name, first, count);
+	if(attrib!=GSALT_VERTEX && !(pgsalt->flags&attrib)) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: Adding %s but it is not activated\n", name);
+		return GSALT_ERROR;
+	}
+	unsigned int given;
+	switch (attrib) {
+		case GSALT_VERTEX: given = pgsalt->model->vert_count(); break;
+		case GSALT_COLOR: given = pgsalt->model->color_count(); break;
+		case GSALT_NORMAL: given = pgsalt->model->normal_count(); break;
+		default: given = pgsalt->model->texcoord_count(); break;
 	}
+	if (!check_chunk(pgsalt, name, first, count, given, pgsalt->num_vertex))
+		return GSALT_ERROR;
+
+	fpointer chunk;
+	init_pointer(&chunk, (void*)pointer, type, size, stride*gsalt_type_bytes(type), 0);
+	ingest(pgsalt, count, (attrib==GSALT_VERTEX)?&chunk:NULL, (attrib==GSALT_COLOR)?&chunk:NULL,
+		(attrib==GSALT_NORMAL)?&chunk:NULL, (attrib==GSALT_TEXCOORD)?&chunk:NULL);
+	ingest_done(pgsalt, func, t0);
+	return GSALT_OK;
+}
+
+gslat_return gsalt_add_vertices(GSalt gsalt, int first, int count, int type, int size, int stride, const void* pointer) {
+	return add_chunk(gsalt, GSALT_VERTEX, "vertices", "gsalt_add_vertices", first, count, type, size, stride, pointer);
+}
+
+gslat_return gsalt_add_colors(GSalt gsalt, int first, int count, int type, int size, int stride, const void* pointer) {
+	return add_chunk(gsalt, GSALT_COLOR, "colors", "gsalt_add_colors", first, count, type, size, stride, pointer);
+}
+
+gslat_return gsalt_add_normals(GSalt gsalt, int first, int count, int type, int stride, const void* pointer) {
+	return add_chunk(gsalt, GSALT_NORMAL, "normals", "gsalt_add_normals", first, count, type, 3, stride, pointer);
+}
+
+gslat_return gsalt_add_texcoords(GSalt gsalt, int first, int count, int type, int size, int stride, const void* pointer) {
+	return add_chunk(gsalt, GSALT_TEXCOORD, "texcoords", "gsalt_add_texcoords", first, count, type, size, stride, pointer);
+}
+
+gslat_return gsalt_add_triangles(GSalt gsalt, int first, int count, int type, const void* pointer) {
+	if ((type!=GSALT_UINT16) && (type!=GSALT_UINT32)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: triangles chunk only support UINT16 and UINT32 (type=%d)\n", type);
+		return GSALT_ERROR;
+	}
+	check_gsalt;
+	check_idle;
+	double t0 = gsalt_time();
+	gsalt_log(gsalt_verbose_debug, "GSalt: triangles chunk (%d, %d)\n", first, count);
+
+	if (!check_chunk(pgsalt, "triangles", first, count, pgsalt->faces_defined, pgsalt->num_triangles))
+		return GSALT_ERROR;
+	// the faces are linked to their vertex right away, so those must be there already
+	multiptr array;
+	array.ptr = (void*)pointer;
+	unsigned int given = pgsalt->model->vert_count();
+	for (int i=0; i<count*3; i++)
+		if (((type)?array.ui16[i]:array.ui32[i])>=given) {
+			gsalt_log(gsalt_verbose_error, "GSalt: triangles chunk uses vertex %d, only %d given so far\n", (type)?array.ui16[i]:array.ui32[i], given);
+			return GSALT_ERROR;
+		}
+
+	ingest_faces(pgsalt, array, type, count);
+	pgsalt->faces_defined += count;
+	ingest_done(pgsalt, "gsalt_add_triangles", t0);
+	return GSALT_OK;
+}
+
+static unsigned char *lock_array(PGSalt pgsalt) {
+	if (!pgsalt->lock)
+		pgsalt->lock = (unsigned char*)calloc(pgsalt->num_vertex?pgsalt->num_vertex:1, 1);
+	return pgsalt->lock;
+}
+
+gslat_return gsalt_lock_vertices(GSalt gsalt, const uint32_t *ids, int n) {
+	check_gsalt;
+	check_idle;
+	gsalt_log(gsalt_verbose_debug, "GSalt: lock %d vertex\n", n);
+	if (n<0 || (n && !ids)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: invalid list of vertex to lock (%d)\n", n);
+		return GSALT_ERROR;
+	}
+	for (int i=0; i<n; i++)
+		if (ids[i]>=(uint32_t)pgsalt->num_vertex) {
+			gsalt_log(gsalt_verbose_error, "GSalt: cannot lock vertex %u, only %d vertex\n", ids[i], pgsalt->num_vertex);
+			return GSALT_ERROR;
+		}
+	unsigned char *lock = lock_array(pgsalt);
+	for (int i=0; i<n; i++)
+		lock[ids[i]] = 1;
+	return GSALT_OK;
+}
+
+gslat_return gsalt_lock_mask(GSalt gsalt, const unsigned char *mask) {
+	check_gsalt;
+	check_idle;
+	if (!mask) {
+		gsalt_log(gsalt_verbose_debug, "GSalt: unlock all vertex\n");
+		free(pgsalt->lock);
+		pgsalt->lock = NULL;
+		return GSALT_OK;
+	}
+	unsigned char *lock = lock_array(pgsalt);
+	int count = 0;
+	for (int i=0; i<pgsalt->num_vertex; i++)
+		count += (lock[i] = (mask[i]!=0));
+	gsalt_log(gsalt_verbose_debug, "GSalt: lock mask, %d vertex locked\n", count);
+	return GSALT_OK;
+}
+
+gslat_return gsalt_set_progress_callback(GSalt gsalt, gsalt_progress_callback callback, void *userdata) {
+	check_gsalt;
+	check_idle;
+	gsalt_log(gsalt_verbose_debug, "GSalt: %s progress callback\n", callback?"set":"remove");
+	pgsalt->progress = callback;
+	pgsalt->progress_data = userdata;
+	return GSALT_OK;
+}
+
+gslat_return gsalt_set_time_budget(GSalt gsalt, double seconds) {
+	check_gsalt;
+	check_idle;
+	if (seconds < 0.0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: negative time budget %g\n", seconds);
+		return GSALT_ERROR;
+	}
+	gsalt_log(gsalt_verbose_debug, "GSalt: time budget %gs\n", seconds);
+	pgsalt->time_budget = seconds;
+	return GSALT_OK;
 }
@@ -0,0 +1,240 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <gsalt/gsalt.h>
+#include "gsalt_convert.h"
+
+static const float defaults[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+
+static inline float clampf(float f, float lo, float hi)
+{
+	return (f<lo)?lo:((f>hi)?hi:f);
+}
+
+static inline float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h&0x8000)<<16;
+	uint32_t exp = (h>>10)&0x1f;
+	uint32_t mant = h&0x3ff;
+	float f;
+	if (exp==0) {
+		// zero and subnormals
+		f = (float)mant*(1.0f/16777216.0f);
+		return sign?-f:f;
+	}
+	uint32_t x = (exp==31)?(sign|0x7f800000|(mant<<13)):(sign|((exp+112)<<23)|(mant<<13));
+	memcpy(&f, &x, 4);
+	return f;
+}
+
+// round to nearest even, overflow to infinity
+static inline uint16_t float_to_half(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, 4);
+	uint16_t sign = (x>>16)&0x8000;
+	uint32_t absx = x&0x7fffffff;
+	if (absx>=0x7f800000)
+		return sign|0x7c00|((absx>0x7f800000)?0x200:0);
+	if (absx>=0x477ff000)
+		return sign|0x7c00;
+	if (absx<0x38800000) {
+		float a;
+		memcpy(&a, &absx, 4);
+		return sign|(uint16_t)lrintf(a*16777216.0f);
+	}
+	// rebias the exponent (127 -> 15) and round the mantissa
+	absx += 0xc8000fff + ((absx>>13)&1);
+	return sign|(uint16_t)(absx>>13);
+}
+
+int gsalt_type_valid(int type, int size)
+{
+	switch (type) {
+		case GSALT_FLOAT:
+		case GSALT_HALF_FLOAT:
+		case GSALT_UNSIGNED_BYTE_NORM:
+		case GSALT_BYTE_NORM:
+		case GSALT_UNSIGNED_SHORT_NORM:
+		case GSALT_SHORT_NORM:
+			return size>0 && size<=4;
+		case GSALT_INT_2_10_10_10:
+			return size==3 || size==4;
+	}
+	return 0;
+}
+
+int gsalt_type_bytes(int type)
+{
+	switch (type) {
+		case GSALT_HALF_FLOAT:
+		case GSALT_UNSIGNED_SHORT_NORM:
+		case GSALT_SHORT_NORM:
+			return 2;
+		case GSALT_UNSIGNED_BYTE_NORM:
+		case GSALT_BYTE_NORM:
+			return 1;
+	}
+	return 4;
+}
+
+int gsalt_element_bytes(int type, int size)
+{
+	return (type==GSALT_INT_2_10_10_10)?4:size*gsalt_type_bytes(type);
+}
+
+#define DECODE(T, EXPR) \
+	for (int i=0; i<count; i++) { \
+		const T *s = (const T*)((const char*)src+i*src_stride); \
+		float *d = dst+i*dst_stride; \
+		for (int k=0; k<m; k++) d[k] = EXPR; \
+		for (int k=m; k<n; k++) d[k] = defaults[k]; \
+	} \
+	break
+
+void gsalt_decode(float *dst, int dst_stride, int n, const void *src, int src_stride, int type, int size, int count)
+{
+	int m = (size<n)?size:n;
+	switch (type) {
+		case GSALT_FLOAT:
+			if (m==n && src_stride==(int)sizeof(float)*n && dst_stride==n) {
+				memcpy(dst, src, sizeof(float)*n*count);
+				break;
+			}
+			DECODE(float, s[k]);
+		case GSALT_HALF_FLOAT:
+			DECODE(uint16_t, half_to_float(s[k]));
+		case GSALT_UNSIGNED_BYTE_NORM:
+			DECODE(uint8_t, s[k]*(1.0f/255.0f));
+		case GSALT_BYTE_NORM:
+			DECODE(int8_t, fmaxf(s[k]*(1.0f/127.0f), -1.0f));
+		case GSALT_UNSIGNED_SHORT_NORM:
+			DECODE(uint16_t, s[k]*(1.0f/65535.0f));
+		case GSALT_SHORT_NORM:
+			DECODE(int16_t, fmaxf(s[k]*(1.0f/32767.0f), -1.0f));
+		case GSALT_INT_2_10_10_10:
+			for (int i=0; i<count; i++) {
+				uint32_t v = *(const uint32_t*)((const char*)src+i*src_stride);
+				float c[4];
+				// sign extend the 3 10 bits fields and the 2 bits one
+				c[0] = fmaxf((float)((int32_t)(v<<22)>>22)*(1.0f/511.0f), -1.0f);
+				c[1] = fmaxf((float)((int32_t)(v<<12)>>22)*(1.0f/511.0f), -1.0f);
+				c[2] = fmaxf((float)((int32_t)(v<<2)>>22)*(1.0f/511.0f), -1.0f);
+				c[3] = fmaxf((float)((int32_t)v>>30), -1.0f);
+				float *d = dst+i*dst_stride;
+				for (int k=0; k<m; k++) d[k] = c[k];
+				for (int k=m; k<n; k++) d[k] = defaults[k];
+			}
+			break;
+	}
+}
+#undef DECODE
+
+#define ENCODE(T, EXPR) \
+	for (int i=0; i<count; i++) { \
+		T *d = (T*)((char*)dst+i*dst_stride); \
+		const float *s = src+i*src_stride; \
+		for (int k=0; k<size; k++) d[k] = (T)(EXPR); \
+	} \
+	break
+
+void gsalt_encode(void *dst, int dst_stride, int type, int size, const float *src, int src_stride, int count)
+{
+	switch (type) {
+		case GSALT_FLOAT:
+			ENCODE(float, s[k]);
+		case GSALT_HALF_FLOAT:
+			ENCODE(uint16_t, float_to_half(s[k]));
+		case GSALT_UNSIGNED_BYTE_NORM:
+			ENCODE(uint8_t, lrintf(clampf(s[k], 0.0f, 1.0f)*255.0f));
+		case GSALT_BYTE_NORM:
+			ENCODE(int8_t, lrintf(clampf(s[k], -1.0f, 1.0f)*127.0f));
+		case GSALT_UNSIGNED_SHORT_NORM:
+			ENCODE(uint16_t, lrintf(clampf(s[k], 0.0f, 1.0f)*65535.0f));
+		case GSALT_SHORT_NORM:
+			ENCODE(int16_t, lrintf(clampf(s[k], -1.0f, 1.0f)*32767.0f));
+		case GSALT_INT_2_10_10_10:
+			for (int i=0; i<count; i++) {
+				const float *s = src+i*src_stride;
+				uint32_t x = (uint32_t)lrintf(clampf(s[0], -1.0f, 1.0f)*511.0f)&0x3ff;
+				uint32_t y = (uint32_t)lrintf(clampf(s[1], -1.0f, 1.0f)*511.0f)&0x3ff;
+				uint32_t z = (uint32_t)lrintf(clampf(s[2], -1.0f, 1.0f)*511.0f)&0x3ff;
+				uint32_t w = (size>3)?((uint32_t)lrintf(clampf(s[3], -1.0f, 1.0f))&0x3):0;
+				*(uint32_t*)((char*)dst+i*dst_stride) = x|(y<<10)|(z<<20)|(w<<30);
+			}
+			break;
+	}
+}
+#undef ENCODE
+
+void gsalt_quantize_unorm16(uint16_t *dst, int dst_stride, int n, const float *src, int src_stride, const float *offset, const float *inv_scale, int count)
+{
+	for (int i=0; i<count; i++) {
+		const float *s = src+i*src_stride;
+		uint16_t *d = dst+i*dst_stride;
+		for (int k=0; k<n; k++)
+			d[k] = (uint16_t)lrintf(clampf((s[k]-offset[k])*inv_scale[k], 0.0f, 65535.0f));
+	}
+}
+
+void gsalt_encode_oct16(int16_t *dst, int dst_stride, const float *src, int src_stride, int count)
+{
+	for (int i=0; i<count; i++) {
+		const float *s = src+i*src_stride;
+		// project on the octahedron |x|+|y|+|z|=1, then fold the lower half over the diagonals
+		float l1 = fabsf(s[0])+fabsf(s[1])+fabsf(s[2]);
+		float x = (l1>0.0f)?s[0]/l1:0.0f;
+		float y = (l1>0.0f)?s[1]/l1:0.0f;
+		if (s[2]<0.0f) {
+			float fx = (1.0f-fabsf(y))*((x>=0.0f)?1.0f:-1.0f);
+			float fy = (1.0f-fabsf(x))*((y>=0.0f)?1.0f:-1.0f);
+			x = fx;
+			y = fy;
+		}
+		int16_t *d = dst+i*dst_stride;
+		d[0] = (int16_t)lrintf(clampf(x, -1.0f, 1.0f)*32767.0f);
+		d[1] = (int16_t)lrintf(clampf(y, -1.0f, 1.0f)*32767.0f);
+	}
+}
+
+size_t gsalt_encode_varint(uint8_t *dst, const uint32_t *src, int count, uint32_t *prev)
+{
+	size_t len = 0;
+	uint32_t last = *prev;
+	for (int i=0; i<count; i++) {
+		int32_t delta = (int32_t)(src[i]-last);
+		uint32_t v = ((uint32_t)delta<<1)^(uint32_t)(delta>>31);
+		last = src[i];
+		while (v>=0x80) {
+			if (dst) dst[len] = (uint8_t)(v|0x80);
+			len++;
+			v >>= 7;
+		}
+		if (dst) dst[len] = (uint8_t)v;
+		len++;
+	}
+	*prev = last;
+	return len;
+}
+
+size_t gsalt_decode_varint(uint32_t *dst, int count, const uint8_t *src, size_t size)
+{
+	size_t pos = 0;
+	uint32_t last = 0;
+	for (int i=0; i<count; i++) {
+		uint32_t v = 0;
+		int shift = 0;
+		for (;;) {
+			if (pos>=size || shift>28)
+				return 0;
+			uint8_t b = src[pos++];
+			v |= (uint32_t)(b&0x7f)<<shift;
+			if (!(b&0x80))
+				break;
+			shift += 7;
+		}
+		last += (v>>1)^(0u-(v&1));
+		dst[i] = last;
+	}
+	return pos;
+}
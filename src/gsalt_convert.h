@@ -0,0 +1,33 @@
+#ifndef _GSALT_CONVERT_H_
+#define _GSALT_CONVERT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Conversion of the attribute types (GSALT_FLOAT, GSALT_HALF_FLOAT, the normalized integers
+// and GSALT_INT_2_10_10_10) from / to float, a block of elements at a time.
+
+int gsalt_type_valid(int type, int size);
+// Bytes of one component (of the whole element for the packed GSALT_INT_2_10_10_10): the unit of the strides
+int gsalt_type_bytes(int type);
+// Bytes of one element of size components
+int gsalt_element_bytes(int type, int size);
+
+// Decode count elements (src_stride bytes apart) to n floats each (dst_stride floats apart).
+// Components missing in the source are set to 0 (1 for the 4th one).
+void gsalt_decode(float *dst, int dst_stride, int n, const void *src, int src_stride, int type, int size, int count);
+// Encode count elements of size components, from floats (src_stride floats apart, at least size of them)
+void gsalt_encode(void *dst, int dst_stride, int type, int size, const float *src, int src_stride, int count);
+
+// Quantization for GPU upload, count elements of n floats (src_stride floats apart) to n uint16 each:
+// q = (f-offset)*inv_scale, clamped to 0..65535 (inv_scale 0 for an empty range).
+void gsalt_quantize_unorm16(uint16_t *dst, int dst_stride, int n, const float *src, int src_stride, const float *offset, const float *inv_scale, int count);
+// Octahedral encoding of unit vectors (3 floats, src_stride floats apart) as 2 signed normalized 16 bits
+void gsalt_encode_oct16(int16_t *dst, int dst_stride, const float *src, int src_stride, int count);
+// LEB128 of the zigzag encoded delta of each index to the previous one (*prev, updated, for the first).
+// Gives back the number of bytes, dst can be NULL to only count them.
+size_t gsalt_encode_varint(uint8_t *dst, const uint32_t *src, int count, uint32_t *prev);
+// The reverse, gives back the number of bytes read (0 if src is too short)
+size_t gsalt_decode_varint(uint32_t *dst, int count, const uint8_t *src, size_t size);
+
+#endif //_GSALT_CONVERT_H_
@@ -0,0 +1,1005 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <gsalt/gsalt.h>
+#include "gsalt_timer.h"
+#include "gsalt_trace.h"
+#include "gsalt_loader.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+void gsalt_log(gsalt_verbose level, const char *fmt, ...);
+
+// The file is mapped, cut in chunks on line boundaries (or records for the binary formats),
+// and each chunk is parsed on its own thread in its own arrays. The chunks are then
+// concatenated, and the mesh is given to the model with the gsalt_add_* functions.
+
+int gsalt_map_file(const char *filename, gsalt_mapped_file *m)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file==INVALID_HANDLE_VALUE)
+		return 0;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || !size.QuadPart) {
+		CloseHandle(file);
+		return 0;
+	}
+	m->size = (size_t)size.QuadPart;
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	m->data = (mapping)?(const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0):NULL;
+	if (!m->data) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		return 0;
+	}
+	m->file = file;
+	m->mapping = mapping;
+	return 1;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd<0)
+		return 0;
+	struct stat st;
+	if (fstat(fd, &st) || !st.st_size) {
+		close(fd);
+		return 0;
+	}
+	m->size = (size_t)st.st_size;
+	void *p = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p==MAP_FAILED)
+		return 0;
+	// the chunks are read at the same time, not front to back
+	madvise(p, m->size, MADV_WILLNEED);
+	m->data = (const char*)p;
+	return 1;
+#endif
+}
+
+void gsalt_unmap_file(gsalt_mapped_file *m)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(m->data);
+	CloseHandle((HANDLE)m->mapping);
+	CloseHandle((HANDLE)m->file);
+#else
+	munmap((void*)m->data, m->size);
+#endif
+}
+
+// one thread per MB, up to the number of cores
+static int loader_threads(size_t size)
+{
+	int n = (int)std::thread::hardware_concurrency();
+	int want = (int)(size>>20)+1;
+	if (n<1) n = 1;
+	return (want<n)?want:n;
+}
+
+template <typename F>
+static void parallel_for(int n, F fn)
+{
+	std::vector<std::thread> threads;
+	for (int i=1; i<n; i++)
+		threads.push_back(std::thread(fn, i));
+	fn(0);
+	for (size_t i=0; i<threads.size(); i++)
+		threads[i].join();
+}
+
+// n+1 cuts of [begin, end), each at the start of a line
+static void split_lines(const char *begin, const char *end, int n, std::vector<const char*> &cuts)
+{
+	cuts.resize(n+1);
+	cuts[0] = begin;
+	cuts[n] = end;
+	for (int i=1; i<n; i++) {
+		const char *p = begin+(size_t)(end-begin)*i/n;
+		if (p<cuts[i-1])
+			p = cuts[i-1];
+		const char *nl = (const char*)memchr(p, '\n', end-p);
+		cuts[i] = (nl)?nl+1:end;
+	}
+}
+
+static inline const char *skip_blanks(const char *p, const char *end)
+{
+	while (p<end && (*p==' ' || *p=='\t' || *p=='\r'))
+		p++;
+	return p;
+}
+
+static inline const char *next_line(const char *p, const char *end)
+{
+	const char *nl = (const char*)memchr(p, '\n', end-p);
+	return (nl)?nl+1:end;
+}
+
+static const double pow10_table[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Plain decimal with optional exponent, no locale (the file is not 0 terminated, so no strtod).
+// Gives back NULL if there is no number.
+static const char *parse_float(const char *p, const char *end, float *f)
+{
+	p = skip_blanks(p, end);
+	int neg = 0;
+	if (p<end && (*p=='-' || *p=='+')) {
+		neg = (*p=='-');
+		p++;
+	}
+	uint64_t mant = 0;
+	int exp = 0, digits = 0;
+	// 18 significant digits are exact in the mantissa, the others only move the exponent
+	for (; p<end && *p>='0' && *p<='9'; p++, digits++) {
+		if (mant<100000000000000000ULL)
+			mant = mant*10+(*p-'0');
+		else
+			exp++;
+	}
+	if (p<end && *p=='.')
+		for (p++; p<end && *p>='0' && *p<='9'; p++, digits++)
+			if (mant<100000000000000000ULL) {
+				mant = mant*10+(*p-'0');
+				exp--;
+			}
+	if (!digits)
+		return NULL;
+	if (p<end && (*p=='e' || *p=='E')) {
+		const char *q = p+1;
+		int eneg = 0, e = 0;
+		if (q<end && (*q=='-' || *q=='+')) {
+			eneg = (*q=='-');
+			q++;
+		}
+		if (q<end && *q>='0' && *q<='9') {
+			for (; q<end && *q>='0' && *q<='9'; q++)
+				if (e<10000)
+					e = e*10+(*q-'0');
+			exp += (eneg)?-e:e;
+			p = q;
+		}
+	}
+	double d = (double)mant;
+	if (exp<0)
+		d = (exp>=-22)?d/pow10_table[-exp]:d*pow(10.0, exp);
+	else if (exp>0)
+		d = (exp<=22)?d*pow10_table[exp]:d*pow(10.0, exp);
+	*f = (float)((neg)?-d:d);
+	return p;
+}
+
+static const char *parse_int(const char *p, const char *end, int *v)
+{
+	int neg = 0;
+	if (p<end && (*p=='-' || *p=='+')) {
+		neg = (*p=='-');
+		p++;
+	}
+	if (p>=end || *p<'0' || *p>'9')
+		return NULL;
+	int x = 0;
+	for (; p<end && *p>='0' && *p<='9'; p++)
+		x = x*10+(*p-'0');
+	*v = (neg)?-x:x;
+	return p;
+}
+
+// What is given to the model
+typedef struct {
+	std::vector<float> pos;		// 3 per vertex
+	std::vector<float> color;	// 4
+	std::vector<float> normal;	// 3
+	std::vector<float> texcoord;	// 2
+	std::vector<uint32_t> tris;
+} loaded_mesh;
+
+template <typename T>
+static void append(std::vector<T> &dst, const std::vector<T> &src)
+{
+	dst.insert(dst.end(), src.begin(), src.end());
+}
+
+static GSalt build_model(loaded_mesh &m, unsigned int flags, const char *filename)
+{
+	int nv = (int)(m.pos.size()/3);
+	int nt = (int)(m.tris.size()/3);
+	if (!nt) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s has no triangles\n", filename);
+		return NULL;
+	}
+	for (size_t i=0; i<m.tris.size(); i++)
+		if (m.tris[i]>=(uint32_t)nv) {
+			gsalt_log(gsalt_verbose_error, "GSalt: %s has a face index out of range (%u)\n", filename, m.tris[i]);
+			return NULL;
+		}
+	static const struct {unsigned int flag; const char *name;} attribs[3] = {
+		{GSALT_COLOR, "color"}, {GSALT_NORMAL, "normal"}, {GSALT_TEXCOORD, "texcoord"}
+	};
+	const std::vector<float> *arrays[3] = {&m.color, &m.normal, &m.texcoord};
+	for (int k=0; k<3; k++)
+		if ((flags&attribs[k].flag) && arrays[k]->empty()) {
+			gsalt_log(gsalt_verbose_debug, "GSalt: %s has no %s, dropped from the flags\n", filename, attribs[k].name);
+			flags &= ~attribs[k].flag;
+		}
+
+	GSalt gsalt = gsalt_new(nv, nt, flags);
+	if (!gsalt)
+		return NULL;
+	if (gsalt_add_vertices(gsalt, 0, nv, GSALT_FLOAT, 3, 0, m.pos.data())
+	 || ((flags&GSALT_COLOR) && gsalt_add_colors(gsalt, 0, nv, GSALT_FLOAT, 4, 0, m.color.data()))
+	 || ((flags&GSALT_NORMAL) && gsalt_add_normals(gsalt, 0, nv, GSALT_FLOAT, 0, m.normal.data()))
+	 || ((flags&GSALT_TEXCOORD) && gsalt_add_texcoords(gsalt, 0, nv, GSALT_FLOAT, 2, 0, m.texcoord.data()))
+	 || gsalt_add_triangles(gsalt, 0, nt, GSALT_UINT32, m.tris.data())) {
+		gsalt_delete(gsalt);
+		return NULL;
+	}
+	return gsalt;
+}
+
+// OBJ
+
+typedef struct {
+	std::vector<float> v, vt, vn, vc;	// vc: colors of "v x y z r g b" lines
+	std::vector<int> corners;			// v, vt, vn of each triangle corner, 0 based (-1 if absent)
+	std::vector<uint32_t> relative;		// corners given relative to the end of their list (negative in the file)
+	int errors;
+} obj_chunk;
+
+static void obj_parse(const char *p, const char *end, obj_chunk *c)
+{
+	c->errors = 0;
+	while (p<end) {
+		const char *line = skip_blanks(p, end);
+		p = next_line(line, end);
+		if (line+1>=end)
+			continue;
+		if (line[0]=='v' && (line[1]==' ' || line[1]=='\t')) {
+			float x[6];
+			const char *q = line+2;
+			int n = 0;
+			while (n<6 && (q = parse_float(q, p, x+n)))
+				n++;
+			if (n<3) {
+				c->errors++;
+				continue;
+			}
+			c->v.insert(c->v.end(), x, x+3);
+			if (n==6 || !c->vc.empty()) {
+				// colors appear: the vertex before were white
+				c->vc.resize(c->v.size()-3, 1.0f);
+				if (n==6)
+					c->vc.insert(c->vc.end(), x+3, x+6);
+				else
+					c->vc.insert(c->vc.end(), 3, 1.0f);
+			}
+		} else if (line[0]=='v' && line[1]=='t') {
+			float x[2] = {0.0f, 0.0f};
+			const char *q = parse_float(line+2, p, x);
+			if (!q) {
+				c->errors++;
+				continue;
+			}
+			parse_float(q, p, x+1);
+			c->vt.insert(c->vt.end(), x, x+2);
+		} else if (line[0]=='v' && line[1]=='n') {
+			float x[3];
+			const char *q = line+2;
+			int n = 0;
+			while (n<3 && (q = parse_float(q, p, x+n)))
+				n++;
+			if (n<3) {
+				c->errors++;
+				continue;
+			}
+			c->vn.insert(c->vn.end(), x, x+3);
+		} else if (line[0]=='f' && (line[1]==' ' || line[1]=='\t')) {
+			// v, v/vt, v//vn or v/vt/vn per corner, polygons are split in fans
+			int counts[3] = {(int)(c->v.size()/3), (int)(c->vt.size()/2), (int)(c->vn.size()/3)};
+			int first[3], prev[3], cur[3];
+			int first_rel = 0, prev_rel = 0, cur_rel;
+			int n = 0;
+			const char *q = line+2;
+			for (;;) {
+				q = skip_blanks(q, p);
+				if (q>=p || *q=='\n' || *q=='#')
+					break;
+				int idx[3] = {0, 0, 0};
+				const char *r = parse_int(q, p, idx);
+				if (!r) {
+					c->errors++;
+					break;
+				}
+				q = r;
+				if (q<p && *q=='/') {
+					q++;
+					if ((r = parse_int(q, p, idx+1)))
+						q = r;
+					if (q<p && *q=='/' && (r = parse_int(q+1, p, idx+2)))
+						q = r;
+				}
+				while (q<p && *q!=' ' && *q!='\t' && *q!='\r' && *q!='\n')
+					q++;
+				cur_rel = 0;
+				for (int k=0; k<3; k++) {
+					if (idx[k]>0)
+						cur[k] = idx[k]-1;
+					else if (idx[k]<0) {
+						cur[k] = counts[k]+idx[k];
+						cur_rel |= 1<<k;
+					} else
+						cur[k] = -1;
+				}
+				if (n==0) {
+					memcpy(first, cur, sizeof(first));
+					first_rel = cur_rel;
+				} else if (n>=2) {
+					const int *tri[3] = {first, prev, cur};
+					int rel[3] = {first_rel, prev_rel, cur_rel};
+					for (int j=0; j<3; j++)
+						for (int k=0; k<3; k++) {
+							if (rel[j]&(1<<k))
+								c->relative.push_back((uint32_t)c->corners.size());
+							c->corners.push_back(tri[j][k]);
+						}
+				}
+				memcpy(prev, cur, sizeof(prev));
+				prev_rel = cur_rel;
+				n++;
+			}
+		}
+	}
+}
+
+// open addressing table of the v/vt/vn triplets already seen
+static inline uint32_t hash3(uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t h = a*0x9E3779B1u ^ b*0x85EBCA77u ^ c*0xC2B2AE3Du;
+	return h^(h>>15);
+}
+
+static GSalt load_obj(const gsalt_mapped_file *f, unsigned int flags, const char *filename)
+{
+	int nthreads = loader_threads(f->size);
+	std::vector<const char*> cuts;
+	split_lines(f->data, f->data+f->size, nthreads, cuts);
+	std::vector<obj_chunk> chunks(nthreads);
+	parallel_for(nthreads, [&](int i) { obj_parse(cuts[i], cuts[i+1], &chunks[i]); });
+
+	// concatenate, fixing the relative indexes and the colors
+	int has_color = 0, errors = 0;
+	for (int i=0; i<nthreads; i++) {
+		has_color |= !chunks[i].vc.empty();
+		errors += chunks[i].errors;
+	}
+	if (errors)
+		gsalt_log(gsalt_verbose_warning, "GSalt: %s has %d malformed lines\n", filename, errors);
+	std::vector<float> v, vt, vn, vc;
+	std::vector<int> corners;
+	for (int i=0; i<nthreads; i++) {
+		obj_chunk *c = &chunks[i];
+		int offset[3] = {(int)(v.size()/3), (int)(vt.size()/2), (int)(vn.size()/3)};
+		for (size_t j=0; j<c->relative.size(); j++) {
+			uint32_t r = c->relative[j];
+			c->corners[r] += offset[r%3];
+		}
+		if (has_color)
+			c->vc.resize(c->v.size(), 1.0f);
+		append(v, c->v);
+		append(vt, c->vt);
+		append(vn, c->vn);
+		append(vc, c->vc);
+		append(corners, c->corners);
+		*c = obj_chunk();
+	}
+	int counts[3] = {(int)(v.size()/3), (int)(vt.size()/2), (int)(vn.size()/3)};
+	for (size_t j=0; j<corners.size(); j++)
+		if (corners[j]>=counts[j%3] || (j%3==0 && corners[j]<0) || corners[j]<-1) {
+			gsalt_log(gsalt_verbose_error, "GSalt: %s has a face index out of range\n", filename);
+			return NULL;
+		}
+
+	int use_vt = (flags&GSALT_TEXCOORD) && counts[1];
+	int use_vn = (flags&GSALT_NORMAL) && counts[2];
+	int use_vc = (flags&GSALT_COLOR) && has_color;
+	loaded_mesh m;
+	size_t ncorners = corners.size()/3;
+	m.tris.resize(ncorners);
+	if (!use_vt && !use_vn) {
+		// the vertex are the positions
+		m.pos.swap(v);
+		for (size_t j=0; j<ncorners; j++)
+			m.tris[j] = corners[j*3];
+	} else {
+		// one vertex per v/vt/vn triplet
+		size_t size = 16;
+		while (size<ncorners*2)
+			size <<= 1;
+		std::vector<int32_t> table(size, -1);
+		std::vector<int> triplets;
+		for (size_t j=0; j<ncorners; j++) {
+			int t[3] = {corners[j*3], (use_vt)?corners[j*3+1]:-1, (use_vn)?corners[j*3+2]:-1};
+			size_t h = hash3(t[0], t[1], t[2])&(size-1);
+			while (table[h]>=0 && memcmp(&triplets[table[h]*3], t, sizeof(t)))
+				h = (h+1)&(size-1);
+			if (table[h]<0) {
+				table[h] = (int32_t)(triplets.size()/3);
+				triplets.insert(triplets.end(), t, t+3);
+			}
+			m.tris[j] = table[h];
+		}
+		size_t nv = triplets.size()/3;
+		m.pos.resize(nv*3);
+		if (use_vc) m.color.resize(nv*4);
+		if (use_vt) m.texcoord.resize(nv*2, 0.0f);
+		if (use_vn) m.normal.resize(nv*3, 0.0f);
+		for (size_t i=0; i<nv; i++) {
+			int *t = &triplets[i*3];
+			memcpy(&m.pos[i*3], &v[t[0]*3], sizeof(float)*3);
+			if (use_vc) {
+				memcpy(&m.color[i*4], &vc[t[0]*3], sizeof(float)*3);
+				m.color[i*4+3] = 1.0f;
+			}
+			if (use_vt && t[1]>=0)
+				memcpy(&m.texcoord[i*2], &vt[t[1]*2], sizeof(float)*2);
+			if (use_vn && t[2]>=0)
+				memcpy(&m.normal[i*3], &vn[t[2]*3], sizeof(float)*3);
+		}
+		use_vc = 0;
+	}
+	if (use_vc) {
+		size_t nv = vc.size()/3;
+		m.color.resize(nv*4);
+		for (size_t i=0; i<nv; i++) {
+			memcpy(&m.color[i*4], &vc[i*3], sizeof(float)*3);
+			m.color[i*4+3] = 1.0f;
+		}
+	}
+	return build_model(m, flags, filename);
+}
+
+// PLY
+
+// records given at a time by gsalt_ply_walk
+#define WALK_BLOCK 4096
+
+enum {PLY_NONE, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64};
+static const int ply_sizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+// where a vertex property goes in the 12 values of a vertex (PLY_INDEXES for the face list)
+enum {PLY_X=0, PLY_NX=3, PLY_RED=6, PLY_S=10, PLY_VALUES=12, PLY_INDEXES=12, PLY_SKIP=-1};
+static const float ply_defaults[PLY_VALUES] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+
+typedef struct {
+	int type;
+	int count_type;		// PLY_NONE if not a list
+	int slot;
+	float scale;		// integer colors are normalized
+} ply_prop;
+
+typedef struct {
+	int kind;			// 0 other, 1 vertex, 2 face
+	long count;
+	int record;			// bytes of a record, 0 if it has lists
+	std::vector<ply_prop> props;
+} ply_element;
+
+static int ply_type(const char *s)
+{
+	static const char *names[] = {"char", "uchar", "short", "ushort", "int", "uint", "float", "double"};
+	static const char *sized[] = {"int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64"};
+	for (int i=0; i<8; i++)
+		if (!strcmp(s, names[i]) || !strcmp(s, sized[i]))
+			return i+1;
+	return PLY_NONE;
+}
+
+static int ply_slot(const char *s)
+{
+	static const struct {const char *name; int slot;} slots[] = {
+		{"x", PLY_X}, {"y", PLY_X+1}, {"z", PLY_X+2},
+		{"nx", PLY_NX}, {"ny", PLY_NX+1}, {"nz", PLY_NX+2},
+		{"red", PLY_RED}, {"green", PLY_RED+1}, {"blue", PLY_RED+2}, {"alpha", PLY_RED+3},
+		{"diffuse_red", PLY_RED}, {"diffuse_green", PLY_RED+1}, {"diffuse_blue", PLY_RED+2},
+		{"s", PLY_S}, {"t", PLY_S+1}, {"u", PLY_S}, {"v", PLY_S+1},
+		{"texture_u", PLY_S}, {"texture_v", PLY_S+1}, {"texture_s", PLY_S}, {"texture_t", PLY_S+1}
+	};
+	for (size_t i=0; i<sizeof(slots)/sizeof(slots[0]); i++)
+		if (!strcmp(s, slots[i].name))
+			return slots[i].slot;
+	return PLY_SKIP;
+}
+
+static inline double ply_value(const char *p, int type, int swap)
+{
+	unsigned char b[8];
+	int n = ply_sizes[type];
+	if (swap)
+		for (int i=0; i<n; i++)
+			b[i] = p[n-1-i];
+	else
+		memcpy(b, p, n);
+	switch (type) {
+		case PLY_INT8: { int8_t v; memcpy(&v, b, 1); return v; }
+		case PLY_UINT8: return b[0];
+		case PLY_INT16: { int16_t v; memcpy(&v, b, 2); return v; }
+		case PLY_UINT16: { uint16_t v; memcpy(&v, b, 2); return v; }
+		case PLY_INT32: { int32_t v; memcpy(&v, b, 4); return v; }
+		case PLY_UINT32: { uint32_t v; memcpy(&v, b, 4); return v; }
+		case PLY_FLOAT32: { float v; memcpy(&v, b, 4); return v; }
+		case PLY_FLOAT64: { double v; memcpy(&v, b, 8); return v; }
+	}
+	return 0.0;
+}
+
+// which attributes the vertex element has (bit 0 normal, 1 color, 2 texcoord)
+static int ply_attribs(const ply_element *e)
+{
+	int attribs = 0;
+	for (size_t i=0; i<e->props.size(); i++) {
+		int slot = e->props[i].slot;
+		if (slot>=PLY_NX && slot<PLY_RED) attribs |= 1;
+		else if (slot>=PLY_RED && slot<PLY_S) attribs |= 2;
+		else if (slot>=PLY_S && slot<PLY_VALUES) attribs |= 4;
+	}
+	return attribs;
+}
+
+static void ply_push_vertex(loaded_mesh *m, const float *vals, int attribs)
+{
+	m->pos.insert(m->pos.end(), vals+PLY_X, vals+PLY_X+3);
+	if (attribs&1) m->normal.insert(m->normal.end(), vals+PLY_NX, vals+PLY_NX+3);
+	if (attribs&2) m->color.insert(m->color.end(), vals+PLY_RED, vals+PLY_RED+4);
+	if (attribs&4) m->texcoord.insert(m->texcoord.end(), vals+PLY_S, vals+PLY_S+2);
+}
+
+// k-th index of a polygon, as a fan around the first one (any number of indexes)
+static void push_fan(std::vector<uint32_t> &tris, uint32_t *first, uint32_t *prev, int k, uint32_t idx)
+{
+	if (k==0)
+		*first = idx;
+	else if (k>=2) {
+		tris.push_back(*first);
+		tris.push_back(*prev);
+		tris.push_back(idx);
+	}
+	*prev = idx;
+}
+
+// binary record, gives back the end of the record (NULL if it goes past end)
+static const char *ply_binary_record(const char *p, const char *end, const ply_element *e, int swap, float *vals, std::vector<uint32_t> *tris)
+{
+	uint32_t first = 0, prev = 0;
+	for (size_t i=0; i<e->props.size(); i++) {
+		const ply_prop *prop = &e->props[i];
+		if (prop->count_type==PLY_NONE) {
+			if (p+ply_sizes[prop->type]>end)
+				return NULL;
+			if (vals && prop->slot>=0)
+				vals[prop->slot] = (float)ply_value(p, prop->type, swap)*prop->scale;
+			p += ply_sizes[prop->type];
+			continue;
+		}
+		if (p+ply_sizes[prop->count_type]>end)
+			return NULL;
+		long n = (long)ply_value(p, prop->count_type, swap);
+		p += ply_sizes[prop->count_type];
+		if (n<0 || p+n*ply_sizes[prop->type]>end)
+			return NULL;
+		if (tris && prop->slot==PLY_INDEXES)
+			for (long k=0; k<n; k++)
+				push_fan(*tris, &first, &prev, (int)k, (uint32_t)ply_value(p+k*ply_sizes[prop->type], prop->type, swap));
+		p += n*ply_sizes[prop->type];
+	}
+	return p;
+}
+
+// ascii record (one line), gives back 0 if malformed
+static int ply_ascii_record(const char *p, const char *end, const ply_element *e, float *vals, std::vector<uint32_t> *tris)
+{
+	uint32_t first = 0, prev = 0;
+	for (size_t i=0; i<e->props.size(); i++) {
+		const ply_prop *prop = &e->props[i];
+		float f;
+		if (prop->count_type==PLY_NONE) {
+			if (!(p = parse_float(p, end, &f)))
+				return 0;
+			if (vals && prop->slot>=0)
+				vals[prop->slot] = f*prop->scale;
+			continue;
+		}
+		int n, idx;
+		if (!(p = parse_int(skip_blanks(p, end), end, &n)) || n<0)
+			return 0;
+		for (int k=0; k<n; k++) {
+			p = skip_blanks(p, end);
+			if (prop->slot==PLY_INDEXES) {
+				if (!(p = parse_int(p, end, &idx)))
+					return 0;
+				if (tris)
+					push_fan(*tris, &first, &prev, k, (uint32_t)idx);
+			} else if (!(p = parse_float(p, end, &f)))
+				return 0;
+		}
+	}
+	return 1;
+}
+
+// end of count lines from p
+static const char *skip_lines(const char *p, const char *end, long count)
+{
+	for (long i=0; i<count && p<end; i++)
+		p = next_line(p, end);
+	return p;
+}
+
+// parse the header, gives back the start of the data (NULL if not valid).
+// format is 0 ascii, 1 little endian, 2 big endian, and the record size of each element is set
+static const char *ply_header(const gsalt_mapped_file *f, const char *filename, std::vector<ply_element> &elements, int *format)
+{
+	const char *p = f->data, *end = f->data+f->size;
+	*format = -1;
+	char line[256], word[3][64];
+	for (;;) {
+		if (p>=end) {
+			gsalt_log(gsalt_verbose_error, "GSalt: %s has no end_header\n", filename);
+			return NULL;
+		}
+		const char *next = next_line(p, end);
+		size_t len = next-p;
+		if (len>=sizeof(line)) len = sizeof(line)-1;
+		memcpy(line, p, len);
+		line[len] = 0;
+		p = next;
+		int n = sscanf(line, "%63s %63s %63s", word[0], word[1], word[2]);
+		if (n<1)
+			continue;
+		if (!strcmp(word[0], "end_header"))
+			break;
+		if (!strcmp(word[0], "format") && n>=2) {
+			if (!strcmp(word[1], "ascii")) *format = 0;
+			else if (!strcmp(word[1], "binary_little_endian")) *format = 1;
+			else if (!strcmp(word[1], "binary_big_endian")) *format = 2;
+		} else if (!strcmp(word[0], "element") && n>=3) {
+			ply_element e;
+			e.kind = (!strcmp(word[1], "vertex"))?1:(!strcmp(word[1], "face"))?2:0;
+			e.count = atol(word[2]);
+			e.record = 0;
+			elements.push_back(e);
+		} else if (!strcmp(word[0], "property") && n>=3 && !elements.empty()) {
+			ply_element &e = elements.back();
+			ply_prop prop;
+			char type[64], count_type[64], name[64];
+			if (!strcmp(word[1], "list")) {
+				if (sscanf(line, "%*s %*s %63s %63s %63s", count_type, type, name)!=3)
+					continue;
+				prop.count_type = ply_type(count_type);
+				prop.type = ply_type(type);
+				prop.slot = (e.kind==2 && (!strcmp(name, "vertex_indices") || !strcmp(name, "vertex_index")))?PLY_INDEXES:PLY_SKIP;
+			} else {
+				if (sscanf(line, "%*s %63s %63s", type, name)!=2)
+					continue;
+				prop.count_type = PLY_NONE;
+				prop.type = ply_type(type);
+				prop.slot = (e.kind==1)?ply_slot(name):PLY_SKIP;
+			}
+			if (prop.type==PLY_NONE || (!strcmp(word[1], "list") && prop.count_type==PLY_NONE)) {
+				gsalt_log(gsalt_verbose_error, "GSalt: %s has an unknown property type (%s)\n", filename, line);
+				return NULL;
+			}
+			prop.scale = 1.0f;
+			if (prop.slot>=PLY_RED && prop.slot<PLY_S)
+				prop.scale = (prop.type==PLY_UINT8)?1.0f/255.0f:(prop.type==PLY_UINT16)?1.0f/65535.0f:1.0f;
+			e.props.push_back(prop);
+		}
+	}
+	if (*format<0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s has an unknown format\n", filename);
+		return NULL;
+	}
+	for (size_t i=0; i<elements.size(); i++) {
+		ply_element &e = elements[i];
+		e.record = 0;
+		for (size_t k=0; k<e.props.size(); k++) {
+			if (e.props[k].count_type!=PLY_NONE) {
+				e.record = 0;
+				break;
+			}
+			e.record += ply_sizes[e.props[k].type];
+		}
+	}
+	return p;
+}
+
+static GSalt load_ply(const gsalt_mapped_file *f, unsigned int flags, const char *filename)
+{
+	std::vector<ply_element> elements;
+	int format;
+	const char *p = ply_header(f, filename, elements, &format), *end = f->data+f->size;
+	if (!p)
+		return NULL;
+	uint16_t one = 1;
+	int swap = (format==2)==(*(unsigned char*)&one==1);
+
+	int nthreads = loader_threads(f->size);
+	loaded_mesh m;
+	size_t i;
+	for (i=0; i<elements.size(); i++) {
+		const ply_element *e = &elements[i];
+		if (e->count<0) {
+			gsalt_log(gsalt_verbose_error, "GSalt: %s has a negative element count\n", filename);
+			return NULL;
+		}
+		const char *section = p;
+		if (format) {
+			// binary: fixed size records are cut in ranges, the others are walked
+			if (e->record && e->kind!=2) {
+				if ((size_t)(end-p)/e->record<(size_t)e->count)
+					break;
+				p += e->record*e->count;
+				if (e->kind!=1)
+					continue;
+				int attribs = ply_attribs(e);
+				std::vector<loaded_mesh> chunks(nthreads);
+				parallel_for(nthreads, [&](int t) {
+					float vals[PLY_VALUES];
+					for (long j=e->count*t/nthreads; j<e->count*(t+1)/nthreads; j++) {
+						memcpy(vals, ply_defaults, sizeof(vals));
+						ply_binary_record(section+j*e->record, end, e, swap, vals, NULL);
+						ply_push_vertex(&chunks[t], vals, attribs);
+					}
+				});
+				for (int t=0; t<nthreads; t++) {
+					append(m.pos, chunks[t].pos);
+					append(m.normal, chunks[t].normal);
+					append(m.color, chunks[t].color);
+					append(m.texcoord, chunks[t].texcoord);
+				}
+				continue;
+			}
+			int attribs = ply_attribs(e);
+			float vals[PLY_VALUES];
+			long j;
+			for (j=0; j<e->count; j++) {
+				memcpy(vals, ply_defaults, sizeof(vals));
+				if (!(p = ply_binary_record(p, end, e, swap, (e->kind==1)?vals:NULL, (e->kind==2)?&m.tris:NULL)))
+					break;
+				if (e->kind==1)
+					ply_push_vertex(&m, vals, attribs);
+			}
+			if (j<e->count)
+				break;
+		} else {
+			// ascii: one record per line
+			p = skip_lines(p, end, e->count);
+			if (!e->kind)
+				continue;
+			int attribs = ply_attribs(e);
+			std::vector<const char*> cuts;
+			split_lines(section, p, nthreads, cuts);
+			std::vector<loaded_mesh> chunks(nthreads);
+			std::vector<int> errors(nthreads, 0);
+			parallel_for(nthreads, [&](int t) {
+				float vals[PLY_VALUES];
+				for (const char *q = cuts[t]; q<cuts[t+1]; q = next_line(q, cuts[t+1])) {
+					memcpy(vals, ply_defaults, sizeof(vals));
+					if (!ply_ascii_record(q, next_line(q, cuts[t+1]), e, (e->kind==1)?vals:NULL, (e->kind==2)?&chunks[t].tris:NULL))
+						errors[t]++;
+					else if (e->kind==1)
+						ply_push_vertex(&chunks[t], vals, attribs);
+				}
+			});
+			for (int t=0; t<nthreads; t++) {
+				if (errors[t]) {
+					gsalt_log(gsalt_verbose_error, "GSalt: %s has malformed %s lines\n", filename, (e->kind==1)?"vertex":"face");
+					return NULL;
+				}
+				append(m.pos, chunks[t].pos);
+				append(m.normal, chunks[t].normal);
+				append(m.color, chunks[t].color);
+				append(m.texcoord, chunks[t].texcoord);
+				append(m.tris, chunks[t].tris);
+			}
+		}
+	}
+	if (i<elements.size()) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s is truncated\n", filename);
+		return NULL;
+	}
+	return build_model(m, flags, filename);
+}
+
+// walk for gsalt_simplify_file: no threads and no whole arrays, the file can be larger than memory
+int gsalt_ply_walk(const gsalt_mapped_file *f, const char *filename, gsalt_ply_vertices vertices, gsalt_ply_triangles triangles, void *data)
+{
+	std::vector<ply_element> elements;
+	int format;
+	const char *p = ply_header(f, filename, elements, &format), *end = f->data+f->size;
+	if (!p)
+		return 0;
+	uint16_t one = 1;
+	int swap = (format==2)==(*(unsigned char*)&one==1);
+
+	float vals[PLY_VALUES], pos[WALK_BLOCK*3];
+	std::vector<uint32_t> tris;
+	size_t i;
+	for (i=0; i<elements.size(); i++) {
+		const ply_element *e = &elements[i];
+		if (e->count<0) {
+			gsalt_log(gsalt_verbose_error, "GSalt: %s has a negative element count\n", filename);
+			return 0;
+		}
+		if (!e->kind) {
+			if (format && e->record) {
+				if ((size_t)(end-p)/e->record<(size_t)e->count)
+					break;
+				p += e->record*e->count;
+			} else if (!format)
+				p = skip_lines(p, end, e->count);
+			else
+				for (long j=0; j<e->count && p; j++)
+					p = ply_binary_record(p, end, e, swap, NULL, NULL);
+			if (!p)
+				break;
+			continue;
+		}
+		int n = 0;
+		long j;
+		for (j=0; j<e->count; j++) {
+			memcpy(vals, ply_defaults, sizeof(vals));
+			if (format) {
+				if (!(p = ply_binary_record(p, end, e, swap, (e->kind==1)?vals:NULL, (e->kind==2)?&tris:NULL)))
+					break;
+			} else {
+				if (p>=end)
+					break;
+				const char *next = next_line(p, end);
+				if (!ply_ascii_record(p, next, e, (e->kind==1)?vals:NULL, (e->kind==2)?&tris:NULL)) {
+					gsalt_log(gsalt_verbose_error, "GSalt: %s has malformed %s lines\n", filename, (e->kind==1)?"vertex":"face");
+					return 0;
+				}
+				p = next;
+			}
+			if (e->kind==1) {
+				memcpy(pos+n*3, vals+PLY_X, sizeof(float)*3);
+				if (++n==WALK_BLOCK) {
+					vertices(pos, n, data);
+					n = 0;
+				}
+			} else if (tris.size()>=WALK_BLOCK*3) {
+				triangles(tris.data(), (int)(tris.size()/3), data);
+				tris.clear();
+			}
+		}
+		if (n)
+			vertices(pos, n, data);
+		if (!tris.empty())
+			triangles(tris.data(), (int)(tris.size()/3), data);
+		tris.clear();
+		if (j<e->count)
+			break;
+	}
+	if (i<elements.size()) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s is truncated\n", filename);
+		return 0;
+	}
+	return 1;
+}
+
+// STL (binary)
+
+static inline float le_float(const char *p, int swap)
+{
+	char b[4];
+	if (swap) {
+		b[0] = p[3]; b[1] = p[2]; b[2] = p[1]; b[3] = p[0];
+	} else
+		memcpy(b, p, 4);
+	float f;
+	memcpy(&f, b, 4);
+	return f;
+}
+
+static GSalt load_stl(const gsalt_mapped_file *f, unsigned int flags, const char *filename)
+{
+	uint16_t one = 1;
+	int swap = (*(unsigned char*)&one!=1);
+	uint32_t n;
+	memcpy(&n, f->data+80, 4);
+	if (swap)
+		n = (n>>24)|((n>>8)&0xff00)|((n<<8)&0xff0000)|(n<<24);
+	// 50 bytes per triangle: normal, 3 corners, attribute
+	std::vector<float> corners((size_t)n*9);
+	int nthreads = loader_threads(f->size);
+	parallel_for(nthreads, [&](int t) {
+		for (size_t i=(size_t)n*t/nthreads; i<(size_t)n*(t+1)/nthreads; i++) {
+			const char *p = f->data+84+i*50+12;
+			for (int k=0; k<9; k++)
+				// +0.0f makes -0 and 0 the same vertex
+				corners[i*9+k] = le_float(p+k*4, swap)+0.0f;
+		}
+	});
+
+	// weld the corners with the same position
+	loaded_mesh m;
+	size_t size = 16;
+	while (size<(size_t)n*6)
+		size <<= 1;
+	std::vector<int32_t> table(size, -1);
+	m.tris.reserve((size_t)n*3);
+	for (size_t i=0; i<n; i++) {
+		uint32_t idx[3];
+		for (int j=0; j<3; j++) {
+			const float *c = &corners[(i*3+j)*3];
+			uint32_t b[3];
+			memcpy(b, c, sizeof(b));
+			size_t h = hash3(b[0], b[1], b[2])&(size-1);
+			while (table[h]>=0 && memcmp(&m.pos[table[h]*3], c, sizeof(float)*3))
+				h = (h+1)&(size-1);
+			if (table[h]<0) {
+				table[h] = (int32_t)(m.pos.size()/3);
+				m.pos.insert(m.pos.end(), c, c+3);
+			}
+			idx[j] = table[h];
+		}
+		// triangles that collapsed in the weld would only be in the way
+		if (idx[0]!=idx[1] && idx[1]!=idx[2] && idx[2]!=idx[0])
+			m.tris.insert(m.tris.end(), idx, idx+3);
+	}
+	return build_model(m, flags, filename);
+}
+
+static int has_extension(const char *filename, const char *ext)
+{
+	size_t l = strlen(filename), e = strlen(ext);
+	if (l<e)
+		return 0;
+	for (size_t i=0; i<e; i++) {
+		char c = filename[l-e+i];
+		if (c>='A' && c<='Z') c += 'a'-'A';
+		if (c!=ext[i])
+			return 0;
+	}
+	return 1;
+}
+
+GSalt gsalt_load_file(const char *filename, unsigned int flags)
+{
+	gsalt_init();
+	gsalt_log(gsalt_verbose_debug, "GSalt: Load file %s, flags = %x\n", (filename)?filename:"(null)", flags);
+	double t0 = gsalt_time();
+	gsalt_mapped_file f;
+	if (!filename || !gsalt_map_file(filename, &f)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot open \"%s\"\n", (filename)?filename:"(null)");
+		return NULL;
+	}
+	GSalt gsalt = NULL;
+	uint32_t stl_count = 0;
+	if (f.size>=84)
+		memcpy(&stl_count, f.data+80, 4);
+	if (f.size>=4 && !memcmp(f.data, "ply", 3) && (f.data[3]=='\n' || f.data[3]=='\r'))
+		gsalt = load_ply(&f, flags, filename);
+	else if (f.size>=84 && (f.size-84)/50==stl_count && (f.size-84)%50==0)
+		gsalt = load_stl(&f, flags, filename);
+	else if (has_extension(filename, ".stl"))
+		gsalt_log(gsalt_verbose_error, "GSalt: %s is not a binary STL (ascii STL is not supported)\n", filename);
+	else
+		gsalt = load_obj(&f, flags, filename);
+	gsalt_unmap_file(&f);
+	gsalt_trace_complete("gsalt_load_file", t0, gsalt_time());
+	return gsalt;
+}
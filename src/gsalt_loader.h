@@ -0,0 +1,30 @@
+#ifndef _GSALT_LOADER_H_
+#define _GSALT_LOADER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// File mapping and PLY reading shared by gsalt_load_file and gsalt_simplify_file
+
+typedef struct {
+	const char *data;
+	size_t size;
+#ifdef _WIN32
+	void *file;			// HANDLE
+	void *mapping;
+#endif
+} gsalt_mapped_file;
+
+// Read only mapping of the whole file, gives back 0 if it cannot be opened (or is empty)
+int gsalt_map_file(const char *filename, gsalt_mapped_file *m);
+void gsalt_unmap_file(gsalt_mapped_file *m);
+
+// Blocks of vertex positions (3 floats each) and triangles (3 indexes, polygons as fans)
+typedef void (*gsalt_ply_vertices)(const float *pos, int count, void *data);
+typedef void (*gsalt_ply_triangles)(const uint32_t *tris, int count, void *data);
+
+// Walk a PLY file (ascii or binary) front to back, on the calling thread, giving the positions
+// and the triangles in file order. Gives back 0 (after logging why) if the file is not valid.
+int gsalt_ply_walk(const gsalt_mapped_file *f, const char *filename, gsalt_ply_vertices vertices, gsalt_ply_triangles triangles, void *data);
+
+#endif //_GSALT_LOADER_H_
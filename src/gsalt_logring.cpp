@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "gsalt_logring.h"
+
+// Bounded MPMC queue with per slot sequence numbers (D. Vyukov)
+#define LOGRING_SIZE 512	// power of 2
+#define LOGRING_MASK (LOGRING_SIZE-1)
+#define LOGRING_MSG 248
+
+typedef struct {
+	std::atomic<size_t> seq;
+	int level;
+	char msg[LOGRING_MSG];
+} logslot;
+
+static logslot ring[LOGRING_SIZE];
+static std::atomic<size_t> ring_head(0);	// next slot to write
+static std::atomic<size_t> ring_tail(0);	// next slot to read
+static std::atomic<unsigned int> ring_dropped(0);
+
+// slot i is free for the write at position i when its seq is i
+static struct ring_init {
+	ring_init() {
+		for (size_t i=0; i<LOGRING_SIZE; i++)
+			ring[i].seq.store(i, std::memory_order_relaxed);
+	}
+} ring_inited;
+
+int gsalt_logring_push(int level, const char *fmt, va_list args)
+{
+	size_t pos = ring_head.load(std::memory_order_relaxed);
+	logslot *slot;
+	for (;;) {
+		slot = &ring[pos&LOGRING_MASK];
+		size_t seq = slot->seq.load(std::memory_order_acquire);
+		intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+		if (dif==0) {
+			if (ring_head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+				break;
+		} else if (dif<0) {
+			ring_dropped.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		} else
+			pos = ring_head.load(std::memory_order_relaxed);
+	}
+	slot->level = level;
+	vsnprintf(slot->msg, LOGRING_MSG, fmt, args);
+	slot->seq.store(pos+1, std::memory_order_release);
+	return 1;
+}
+
+int gsalt_logring_drain(void (*cb)(int level, const char *msg, void *data), void *data)
+{
+	char msg[LOGRING_MSG];
+	int count = 0;
+	for (;;) {
+		size_t pos = ring_tail.load(std::memory_order_relaxed);
+		logslot *slot;
+		for (;;) {
+			slot = &ring[pos&LOGRING_MASK];
+			size_t seq = slot->seq.load(std::memory_order_acquire);
+			intptr_t dif = (intptr_t)seq - (intptr_t)(pos+1);
+			if (dif==0) {
+				if (ring_tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+					break;
+			} else if (dif<0)
+				return count;
+			else
+				pos = ring_tail.load(std::memory_order_relaxed);
+		}
+		// copy out, so the slot is free again before the callback runs
+		int level = slot->level;
+		memcpy(msg, slot->msg, LOGRING_MSG);
+		slot->seq.store(pos+LOGRING_SIZE, std::memory_order_release);
+		cb(level, msg, data);
+		count++;
+	}
+}
+
+unsigned int gsalt_logring_dropped()
+{
+	return ring_dropped.exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,16 @@
+#ifndef _GSALT_LOGRING_H_
+#define _GSALT_LOGRING_H_
+
+#include <stdarg.h>
+
+// Bounded lock-free ring of formatted log messages (multi producer, multi consumer).
+// Pushing never blocks: when the ring is full the message is dropped and counted.
+
+// Returns 0 if the message was dropped
+int gsalt_logring_push(int level, const char *fmt, va_list args);
+// Hand every pending message to cb, returns how many
+int gsalt_logring_drain(void (*cb)(int level, const char *msg, void *data), void *data);
+// Number of messages dropped since the last call
+unsigned int gsalt_logring_dropped();
+
+#endif //_GSALT_LOGRING_H_
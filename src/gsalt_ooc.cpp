@@ -0,0 +1,893 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <gsalt/gsalt.h>
+#include "qslim/MxQSlim.h"
+#include "qslim/MxPropSlim.h"
+#include "gsalt_timer.h"
+#include "gsalt_trace.h"
+#include "gsalt_loader.h"
+#include "gsalt_writer.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+void gsalt_log(gsalt_verbose level, const char *fmt, ...);
+
+// Out-of-core simplification. The PLY file is walked once, the positions and the triangles going
+// to scratch files that are mapped (so the OS pages them in and out, not the process heap).
+// The bounding box is cut in a grid of G^3 cells, G the smallest power of 2 so each cell fits the
+// budget, and the triangles sorted by cell (of their centroid). A vertex used by several cells is
+// locked, so each cell is simplified on its own with the border untouched, and the survivors keep
+// their global id (moved positions are written back in the scratch file, only their cell sees them).
+// Then the cells are merged 2x2x2 (the vertex now inside a merged cell are unlocked) and simplified
+// again, level after level, up to the single cell of the whole mesh, written to the output.
+
+// finest grid (the cell coordinates of a vertex are kept in bytes)
+#define OOC_MAX_GRID 64
+// vertex and triangles read back at a time from a mesh loaded in memory
+#define OOC_READ_BLOCK 4096
+
+// working memory of the model, quadrics and heap per triangle, for each strategy
+#define OOC_BYTES_PROP 300
+#define OOC_BYTES_EDGE 220
+#define OOC_BYTES_HALFEDGE 232
+#define OOC_BYTES_FACE 160
+
+// A temporary file, written front to back then mapped read / write
+typedef struct {
+	FILE *f;
+	char *data;
+	size_t size;
+} scratch;
+
+static int scratch_open(scratch *s)
+{
+	s->f = tmpfile();
+	s->data = NULL;
+	s->size = 0;
+	return s->f!=NULL;
+}
+
+static int scratch_append(scratch *s, const void *p, size_t n)
+{
+	s->size += n;
+	return fwrite(p, 1, n, s->f)==n;
+}
+
+// n bytes of zero (the file stays sparse where the OS allows it)
+static int scratch_resize(scratch *s, size_t n)
+{
+	if (n<=s->size)
+		return 1;
+	s->size = n;
+#ifdef _WIN32
+	int err = _fseeki64(s->f, (__int64)(n-1), SEEK_SET);
+#else
+	int err = fseeko(s->f, (off_t)(n-1), SEEK_SET);
+#endif
+	return !err && fputc(0, s->f)!=EOF;
+}
+
+static int scratch_map(scratch *s)
+{
+	if (fflush(s->f))
+		return 0;
+	if (!s->size)
+		return 1;
+#ifdef _WIN32
+	// no shared mapping of a tmpfile() here, so it is read back in memory
+	s->data = (char*)malloc(s->size);
+	rewind(s->f);
+	if (!s->data || fread(s->data, 1, s->size, s->f)!=s->size) {
+		free(s->data);
+		s->data = NULL;
+		return 0;
+	}
+#else
+	void *p = mmap(NULL, s->size, PROT_READ|PROT_WRITE, MAP_SHARED, fileno(s->f), 0);
+	if (p==MAP_FAILED)
+		return 0;
+	s->data = (char*)p;
+#endif
+	return 1;
+}
+
+static void scratch_close(scratch *s)
+{
+	if (s->data) {
+#ifdef _WIN32
+		free(s->data);
+#else
+		munmap(s->data, s->size);
+#endif
+	}
+	if (s->f)
+		fclose(s->f);
+	s->f = NULL;
+	s->data = NULL;
+	s->size = 0;
+}
+
+typedef struct {
+	const char *filename;
+	unsigned int flags;
+	int error;
+	uint32_t num_vertex;
+	uint64_t num_triangles;
+	float bbox_min[3];
+	float bbox_max[3];
+	scratch pos;		// 3 floats per vertex
+	scratch raw;		// triangles in file order
+	scratch bounds;		// per vertex, min and max cell x, y, z of the triangles using it
+	int grid;			// G
+	size_t budget_triangles;
+	size_t peak_bytes;
+} ooc_state;
+
+static void walk_vertices(const float *pos, int count, void *data)
+{
+	ooc_state *st = (ooc_state*)data;
+	for (int i=0; i<count; i++)
+		for (int k=0; k<3; k++) {
+			float p = pos[i*3+k];
+			if (!st->num_vertex && !i) st->bbox_min[k] = st->bbox_max[k] = p;
+			if (p<st->bbox_min[k]) st->bbox_min[k] = p;
+			if (p>st->bbox_max[k]) st->bbox_max[k] = p;
+		}
+	if (!scratch_append(&st->pos, pos, sizeof(float)*3*count))
+		st->error = 1;
+	st->num_vertex += count;
+}
+
+static void walk_triangles(const uint32_t *tris, int count, void *data)
+{
+	ooc_state *st = (ooc_state*)data;
+	if (!scratch_append(&st->raw, tris, sizeof(uint32_t)*3*count))
+		st->error = 1;
+	st->num_triangles += count;
+}
+
+// cell of the centroid in the finest grid, for each axis
+static inline void fine_cell(const ooc_state *st, const float *pos, const uint32_t *t, const float *scale, int *c)
+{
+	for (int k=0; k<3; k++) {
+		float m = (pos[t[0]*3+k]+pos[t[1]*3+k]+pos[t[2]*3+k])*(1.0f/3.0f);
+		int x = (int)((m-st->bbox_min[k])*scale[k]);
+		c[k] = (x<0)?0:(x>=OOC_MAX_GRID)?OOC_MAX_GRID-1:x;
+	}
+}
+
+static MxStdSlim *new_slim(MxStdModel &m, unsigned int flags)
+{
+	if (flags&GSALT_FACE)
+		return new MxFaceQSlim(m);
+	if (flags&GSALT_HALFEDGE)
+		return new MxHalfEdgeQSlim(m);
+	if (flags&GSALT_EDGE)
+		return new MxEdgeQSlim(m);
+	return new MxPropSlim(m);
+}
+
+
+// Simplify model to target, the vertex with a non zero lock never move. Gives back the working memory it used.
+static size_t decimate_locked(MxStdModel *model, const unsigned char *lock, unsigned int flags, uint64_t target)
+{
+	MxStdSlim *slim = new_slim(*model, flags);
+	slim->vertex_lock = lock;
+	slim->initialize();
+	if ((flags&GSALT_HALFEDGE) && !(flags&GSALT_FACE) && !((MxHalfEdgeQSlim*)slim)->is_manifold()) {
+		gsalt_log(gsalt_verbose_warning, "GSalt: Mesh is not manifold, simplify using %s strategy\n", "Edge");
+		delete slim;
+		slim = new MxEdgeQSlim(*model);
+		slim->vertex_lock = lock;
+		slim->initialize();
+	}
+	size_t bytes = slim->memory_usage();
+	slim->decimate((unsigned int)target);
+	delete slim;
+	return bytes;
+}
+
+// The valid vertex of the model (vlist gets their id in the model) and the valid triangles, in their rank
+static void compact_model(MxStdModel *model, std::vector<uint32_t> &vlist, std::vector<float> &vpos, std::vector<uint32_t> &tris)
+{
+	std::vector<uint32_t> match(model->vert_count());
+	vlist.clear();
+	vpos.clear();
+	tris.clear();
+	for (MxVertexID i=0; i<model->vert_count(); i++)
+		if (model->vertex_is_valid(i)) {
+			match[i] = (uint32_t)vlist.size();
+			vlist.push_back(i);
+			for (int k=0; k<3; k++)
+				vpos.push_back(model->vertex(i)[k]);
+		}
+	for (MxFaceID i=0; i<model->face_count(); i++)
+		if (model->face_is_valid(i))
+			for (int k=0; k<3; k++)
+				tris.push_back(match[model->face(i).v[k]]);
+}
+
+static int write_positions(const char *output, int format, const std::vector<float> &vpos, const std::vector<uint32_t> &tris)
+{
+	gsalt_array_view arrays[4];
+	memset(arrays, 0, sizeof(arrays));
+	arrays[0].ptr = (const char*)vpos.data();
+	arrays[0].type = GSALT_FLOAT;
+	arrays[0].size = 3;
+	arrays[0].stride = sizeof(float)*3;
+	if (!gsalt_write_mesh(output, format, (int)(vpos.size()/3), arrays, (int)(tris.size()/3), tris.data(), GSALT_UINT32, 1)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot write \"%s\"\n", output);
+		return 0;
+	}
+	return 1;
+}
+
+// Simplify the triangles of one cell to target. Vertex of the cell that other cells (at this level) use are locked.
+// The result goes to out, or to the output file for the last level.
+static int simplify_cell(ooc_state *st, std::vector<uint32_t> &tris, int level, uint64_t target, scratch *out, const char *output, int format)
+{
+	size_t nt = tris.size()/3;
+	if (out && nt<=target)
+		return scratch_append(out, tris.data(), sizeof(uint32_t)*tris.size());
+
+	// the global ids of the cell, sorted: local id is the rank
+	std::vector<uint32_t> ids(tris);
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	size_t nv = ids.size();
+
+	const float *pos = (const float*)st->pos.data;
+	const unsigned char *bounds = (const unsigned char*)st->bounds.data;
+	MxStdModel *model = new MxStdModel((int)nv, (int)nt);
+	std::vector<unsigned char> lock(nv, 0);
+	for (size_t i=0; i<nv; i++) {
+		const float *p = pos+(size_t)ids[i]*3;
+		model->add_vertex(p[0], p[1], p[2]);
+		const unsigned char *b = bounds+(size_t)ids[i]*6;
+		for (int k=0; k<3; k++)
+			if ((b[k]>>level)!=(b[3+k]>>level))
+				lock[i] = 1;
+	}
+	for (size_t i=0; i<nt; i++) {
+		uint32_t v[3];
+		for (int k=0; k<3; k++)
+			v[k] = (uint32_t)(std::lower_bound(ids.begin(), ids.end(), tris[i*3+k])-ids.begin());
+		model->add_face(v[0], v[1], v[2]);
+	}
+
+	size_t bytes = decimate_locked(model, lock.data(), st->flags, target)+(ids.capacity()+tris.capacity())*sizeof(uint32_t)+lock.capacity();
+	if (bytes>st->peak_bytes)
+		st->peak_bytes = bytes;
+
+	int ok;
+	if (out) {
+		// the survivors only belong to this cell, their position is updated in place
+		float *wpos = (float*)st->pos.data;
+		for (size_t i=0; i<nv; i++)
+			if (!lock[i] && model->vertex_is_valid(i))
+				for (int k=0; k<3; k++)
+					wpos[(size_t)ids[i]*3+k] = model->vertex(i)[k];
+		tris.clear();
+		for (size_t i=0; i<nt; i++)
+			if (model->face_is_valid(i))
+				for (int k=0; k<3; k++)
+					tris.push_back(ids[model->face(i).v[k]]);
+		ok = scratch_append(out, tris.data(), sizeof(uint32_t)*tris.size());
+		if (!ok)
+			gsalt_log(gsalt_verbose_error, "GSalt: cannot write the scratch files\n");
+	} else {
+		// last level: compact the vertex and write the file
+		std::vector<float> vpos;
+		compact_model(model, ids, vpos, tris);
+		ok = write_positions(output, format, vpos, tris);
+	}
+	delete model;
+	return ok;
+}
+
+// Sort the triangles by cell of the level 0 grid (of grid cells per axis, 0 for the coarsest one fitting
+// the budget), and set the cell bounds of the vertex. Gives back the triangles per cell in counts.
+static int sort_cells(ooc_state *st, int grid, scratch *sorted, std::vector<uint64_t> &offsets, std::vector<uint64_t> &counts)
+{
+	const float *pos = (const float*)st->pos.data;
+	const uint32_t *raw = (const uint32_t*)st->raw.data;
+	float scale[3];
+	for (int k=0; k<3; k++) {
+		float e = st->bbox_max[k]-st->bbox_min[k];
+		scale[k] = (e>0.0f)?OOC_MAX_GRID/e:0.0f;
+	}
+
+	// triangles per cell of the finest grid, then the coarsest grid where every cell fits
+	std::vector<uint32_t> fine((size_t)OOC_MAX_GRID*OOC_MAX_GRID*OOC_MAX_GRID, 0);
+	for (uint64_t i=0; i<st->num_triangles; i++) {
+		const uint32_t *t = raw+i*3;
+		if (t[0]>=st->num_vertex || t[1]>=st->num_vertex || t[2]>=st->num_vertex) {
+			gsalt_log(gsalt_verbose_error, "GSalt: %s has a face index out of range\n", st->filename);
+			return 0;
+		}
+		int c[3];
+		fine_cell(st, pos, t, scale, c);
+		fine[(c[2]*OOC_MAX_GRID+c[1])*OOC_MAX_GRID+c[0]]++;
+	}
+	int g;
+	for (g=1; g<=OOC_MAX_GRID; g*=2) {
+		int shift = 0;
+		while ((g<<shift)<OOC_MAX_GRID)
+			shift++;
+		counts.assign((size_t)g*g*g, 0);
+		for (int z=0; z<OOC_MAX_GRID; z++)
+			for (int y=0; y<OOC_MAX_GRID; y++)
+				for (int x=0; x<OOC_MAX_GRID; x++)
+					counts[((z>>shift)*g+(y>>shift))*g+(x>>shift)] += fine[(z*OOC_MAX_GRID+y)*OOC_MAX_GRID+x];
+		uint64_t largest = *std::max_element(counts.begin(), counts.end());
+		if (grid) {
+			if (g>=grid || g==OOC_MAX_GRID)
+				break;
+		} else if (largest<=st->budget_triangles || g==OOC_MAX_GRID) {
+			if (largest>st->budget_triangles)
+				gsalt_log(gsalt_verbose_warning, "GSalt: %s has %llu triangles in a single cell, over the memory budget\n", st->filename, (unsigned long long)largest);
+			break;
+		}
+	}
+	st->grid = g;
+	int shift = 0;
+	while ((g<<shift)<OOC_MAX_GRID)
+		shift++;
+	fine.clear();
+	fine.shrink_to_fit();
+
+	offsets.assign(counts.size()+1, 0);
+	for (size_t i=0; i<counts.size(); i++)
+		offsets[i+1] = offsets[i]+counts[i];
+	int ok = scratch_resize(sorted, st->num_triangles*3*sizeof(uint32_t)) && scratch_map(sorted);
+	unsigned char first[6] = {255, 255, 255, 0, 0, 0};
+	for (uint32_t i=0; i<st->num_vertex && ok; i++)
+		ok = scratch_append(&st->bounds, first, 6);
+	if (!ok || !scratch_map(&st->bounds)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot write the scratch files\n");
+		return 0;
+	}
+
+	uint32_t *dst = (uint32_t*)sorted->data;
+	unsigned char *bounds = (unsigned char*)st->bounds.data;
+	std::vector<uint64_t> cursor(offsets.begin(), offsets.end()-1);
+	for (uint64_t i=0; i<st->num_triangles; i++) {
+		const uint32_t *t = raw+i*3;
+		int c[3];
+		fine_cell(st, pos, t, scale, c);
+		for (int k=0; k<3; k++)
+			c[k] >>= shift;
+		memcpy(dst+cursor[((size_t)c[2]*g+c[1])*g+c[0]]++*3, t, sizeof(uint32_t)*3);
+		for (int j=0; j<3; j++) {
+			unsigned char *b = bounds+(size_t)t[j]*6;
+			for (int k=0; k<3; k++) {
+				if (c[k]<b[k]) b[k] = (unsigned char)c[k];
+				if (c[k]>b[3+k]) b[3+k] = (unsigned char)c[k];
+			}
+		}
+	}
+	return 1;
+}
+
+static int is_ply(const gsalt_mapped_file *f)
+{
+	return f->size>=4 && !memcmp(f->data, "ply", 3) && (f->data[3]=='\n' || f->data[3]=='\r');
+}
+
+// Positions and triangles of input in the scratch files of st, mapped. A PLY file is walked,
+// the other formats are loaded in memory first. Gives back 0 (after logging why) if it failed.
+static int read_mesh(ooc_state *st, const char *input)
+{
+	if (!scratch_open(&st->pos) || !scratch_open(&st->raw) || !scratch_open(&st->bounds)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot create the scratch files\n");
+		return 0;
+	}
+	gsalt_mapped_file f;
+	if (!gsalt_map_file(input, &f)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot open \"%s\"\n", input);
+		return 0;
+	}
+	int ok;
+	if (is_ply(&f)) {
+		ok = gsalt_ply_walk(&f, input, walk_vertices, walk_triangles, st);
+		gsalt_unmap_file(&f);
+	} else {
+		gsalt_unmap_file(&f);
+		GSalt gsalt = gsalt_load_file(input, 0);
+		ok = gsalt!=NULL;
+		if (ok) {
+			std::vector<float> pos(OOC_READ_BLOCK*3);
+			std::vector<uint32_t> tris(OOC_READ_BLOCK*3);
+			int nv = gsalt_query_numvertex(gsalt), nt = gsalt_query_numtriangles(gsalt);
+			for (int first=0; first<nv; first+=OOC_READ_BLOCK) {
+				int count = (nv-first<OOC_READ_BLOCK)?(nv-first):OOC_READ_BLOCK;
+				gsalt_query_vertices(gsalt, pos.data(), 0, first, count);
+				walk_vertices(pos.data(), count, st);
+			}
+			for (int first=0; first<nt; first+=OOC_READ_BLOCK) {
+				int count = (nt-first<OOC_READ_BLOCK)?(nt-first):OOC_READ_BLOCK;
+				gsalt_query_triangles_uint32(gsalt, tris.data(), first, count);
+				walk_triangles(tris.data(), count, st);
+			}
+			gsalt_delete(gsalt);
+		}
+	}
+	if (ok && (st->error || !scratch_map(&st->pos) || !scratch_map(&st->raw))) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot write the scratch files\n");
+		ok = 0;
+	}
+	if (ok && !st->num_triangles) {
+		gsalt_log(gsalt_verbose_error, "GSalt: %s has no triangles\n", input);
+		ok = 0;
+	}
+	return ok;
+}
+
+static void ooc_close(ooc_state *st)
+{
+	scratch_close(&st->pos);
+	scratch_close(&st->raw);
+	scratch_close(&st->bounds);
+}
+
+static int in_core(const char *input, const char *output, int format, int objective, unsigned int flags)
+{
+	GSalt gsalt = gsalt_load_file(input, flags);
+	if (!gsalt)
+		return -1;
+	int ret = gsalt_simplify(gsalt, objective);
+	if (ret>=0 && gsalt_save_file(gsalt, output, format)!=GSALT_OK)
+		ret = -1;
+	gsalt_delete(gsalt);
+	return ret;
+}
+
+int gsalt_simplify_file(const char *input, const char *output, int format, int objective, uint64_t memory_budget, unsigned int flags)
+{
+	gsalt_init();
+	gsalt_log(gsalt_verbose_debug, "GSalt: Simplify file %s to %d triangles, budget %llu bytes, flags = %x\n", (input)?input:"(null)", objective, (unsigned long long)memory_budget, flags);
+	if (!input || !output) {
+		gsalt_log(gsalt_verbose_error, "GSalt: gsalt_simplify_file needs an input and an output file\n");
+		return -1;
+	}
+	if (objective<0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: negative objective (%d)\n", objective);
+		return -1;
+	}
+	if (flags&(GSALT_COLOR|GSALT_NORMAL|GSALT_TEXCOORD))
+		gsalt_log(gsalt_verbose_warning, "GSalt: gsalt_simplify_file keeps the positions only, attribute flags ignored\n");
+	flags &= GSALT_FACE|GSALT_EDGE|GSALT_HALFEDGE;
+
+	gsalt_mapped_file f;
+	if (!gsalt_map_file(input, &f)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot open \"%s\"\n", input);
+		return -1;
+	}
+	int ply = is_ply(&f);
+	gsalt_unmap_file(&f);
+	if (!ply) {
+		gsalt_log(gsalt_verbose_warning, "GSalt: %s is not a PLY file, simplified in memory\n", input);
+		return in_core(input, output, format, objective, flags);
+	}
+
+	gsalt_trace_begin("gsalt_simplify_file");
+	double t0 = gsalt_time();
+	ooc_state st;
+	memset(&st, 0, sizeof(st));
+	st.filename = input;
+	st.flags = flags;
+	size_t per_triangle = (flags&GSALT_FACE)?OOC_BYTES_FACE:(flags&GSALT_HALFEDGE)?OOC_BYTES_HALFEDGE:
+		(flags&GSALT_EDGE)?OOC_BYTES_EDGE:OOC_BYTES_PROP;
+	st.budget_triangles = (size_t)(memory_budget/per_triangle);
+	int ret = -1;
+	scratch sorted, levels[2];
+	memset(&sorted, 0, sizeof(sorted));
+	memset(levels, 0, sizeof(levels));
+	std::vector<uint64_t> offsets, counts;
+	if (!read_mesh(&st, input))
+		goto end;
+	gsalt_trace_complete("ooc_stream", t0, gsalt_time());
+
+	{
+		double t1 = gsalt_time();
+		if (!scratch_open(&sorted)) {
+			gsalt_log(gsalt_verbose_error, "GSalt: cannot create the scratch files\n");
+			goto end;
+		}
+		if (!sort_cells(&st, 0, &sorted, offsets, counts))
+			goto end;
+		scratch_close(&st.raw);
+		gsalt_trace_complete("ooc_sort", t1, gsalt_time());
+		gsalt_log(gsalt_verbose_debug, "GSalt: %u vertex, %llu triangles in a %d^3 grid\n", st.num_vertex, (unsigned long long)st.num_triangles, st.grid);
+
+		// each level reads the cells of the level below (from sorted for level 0), and writes its own
+		const uint32_t *in = (const uint32_t*)sorted.data;
+		int in_grid = st.grid;
+		for (int level=0; ; level++) {
+			double t2 = gsalt_time();
+			int g = st.grid>>level;
+			int factor = in_grid/g;
+			scratch *out = (g>1)?&levels[level&1]:NULL;
+			if (out && !scratch_open(out)) {
+				gsalt_log(gsalt_verbose_error, "GSalt: cannot create the scratch files\n");
+				goto end;
+			}
+			std::vector<uint64_t> out_offsets(1, 0), out_counts;
+			std::vector<uint32_t> tris;
+			for (int z=0; z<g; z++)
+				for (int y=0; y<g; y++)
+					for (int x=0; x<g; x++) {
+						uint64_t original = 0;
+						tris.clear();
+						for (int dz=0; dz<factor; dz++)
+							for (int dy=0; dy<factor; dy++)
+								for (int dx=0; dx<factor; dx++) {
+									size_t c = ((size_t)(z*factor+dz)*in_grid+(y*factor+dy))*in_grid+(x*factor+dx);
+									tris.insert(tris.end(), in+offsets[c]*3, in+offsets[c+1]*3);
+									original += counts[c];
+								}
+						// the same ratio in every cell, the exact objective for the whole mesh
+						uint64_t target = (out)?(original*(uint64_t)objective+st.num_triangles-1)/st.num_triangles:(uint64_t)objective;
+						if ((!tris.empty() || !out) && !simplify_cell(&st, tris, level, target, out, output, format))
+							goto end;
+						if (!out)
+							ret = (int)(tris.size()/3);
+						else {
+							out_offsets.push_back(out->size/(sizeof(uint32_t)*3));
+							out_counts.push_back(original);
+						}
+					}
+			gsalt_trace_complete("ooc_level", t2, gsalt_time());
+			if (!out)
+				break;
+			if (!scratch_map(out)) {
+				gsalt_log(gsalt_verbose_error, "GSalt: cannot write the scratch files\n");
+				goto end;
+			}
+			gsalt_log(gsalt_verbose_debug, "GSalt: level %d, %d^3 cells, %llu triangles\n", level, g, (unsigned long long)out_offsets.back());
+			// what the level read is no longer needed
+			if (level)
+				scratch_close(&levels[(level-1)&1]);
+			else
+				scratch_close(&sorted);
+			in = (const uint32_t*)out->data;
+			in_grid = g;
+			offsets.swap(out_offsets);
+			counts.swap(out_counts);
+		}
+	}
+	// the last levels hold the objective plus the seams of the cells below
+	if (st.peak_bytes>memory_budget)
+		gsalt_log(gsalt_verbose_warning, "GSalt: %s needed %llu bytes at the top levels, over the budget (lower the objective)\n", input, (unsigned long long)st.peak_bytes);
+	gsalt_log(gsalt_verbose_warning, "GSalt: Simplified %s from %llu to %d triangles, out of core (peak model memory %llu bytes)\n",
+		input, (unsigned long long)st.num_triangles, ret, (unsigned long long)st.peak_bytes);
+
+end:
+	ooc_close(&st);
+	scratch_close(&sorted);
+	scratch_close(&levels[0]);
+	scratch_close(&levels[1]);
+	gsalt_trace_end("gsalt_simplify_file");
+	return ret;
+}
+
+// Tiles (gsalt_tile_*). The directory has a manifest and a file per tile, in native endianness:
+//  tiles.gst: TILES_MAGIC, grid, num_vertex, num_triangles (64 bits), count, then count * (cell, triangles)
+//  tile_N.gst (split) and tile_N.simplified.gst: TILE_MAGIC, num_vertex, num_triangles, then the global ids,
+//  positions (3 floats) and locks (used by another tile too) of the vertex, and the triangles in local ids.
+
+#define TILES_MAGIC "GSTILES"
+#define TILE_MAGIC "GSTILE1"
+// rings of triangles around the seams simplified again by the stitch
+#define TILE_SEAM_RINGS 3
+
+typedef struct {
+	std::vector<uint32_t> ids;
+	std::vector<float> pos;
+	std::vector<unsigned char> lock;
+	std::vector<uint32_t> tris;
+} tile_mesh;
+
+typedef struct {
+	uint32_t grid;
+	uint32_t num_vertex;
+	uint64_t num_triangles;
+	std::vector<uint32_t> cells;		// of the non empty tiles
+	std::vector<uint32_t> triangles;	// before simplification
+} tile_manifest;
+
+static void tile_path(char *path, size_t size, const char *dir, int tile, const char *suffix)
+{
+	if (tile<0)
+		snprintf(path, size, "%s/tiles.gst", dir);
+	else
+		snprintf(path, size, "%s/tile_%05d%s.gst", dir, tile, suffix);
+}
+
+static int write_manifest(const char *dir, const tile_manifest *m)
+{
+	char path[1024];
+	tile_path(path, sizeof(path), dir, -1, NULL);
+	FILE *f = fopen(path, "wb");
+	if (!f)
+		return 0;
+	uint32_t count = (uint32_t)m->cells.size();
+	int ok = fwrite(TILES_MAGIC, 8, 1, f)==1 && fwrite(&m->grid, 4, 1, f)==1 && fwrite(&m->num_vertex, 4, 1, f)==1
+		&& fwrite(&m->num_triangles, 8, 1, f)==1 && fwrite(&count, 4, 1, f)==1;
+	for (uint32_t i=0; i<count && ok; i++)
+		ok = fwrite(&m->cells[i], 4, 1, f)==1 && fwrite(&m->triangles[i], 4, 1, f)==1;
+	if (fclose(f))
+		ok = 0;
+	return ok;
+}
+
+static int read_manifest(const char *dir, tile_manifest *m)
+{
+	char path[1024], magic[8];
+	tile_path(path, sizeof(path), dir, -1, NULL);
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot open \"%s\"\n", path);
+		return 0;
+	}
+	uint32_t count = 0;
+	int ok = fread(magic, 8, 1, f)==1 && !memcmp(magic, TILES_MAGIC, 8) && fread(&m->grid, 4, 1, f)==1
+		&& fread(&m->num_vertex, 4, 1, f)==1 && fread(&m->num_triangles, 8, 1, f)==1 && fread(&count, 4, 1, f)==1;
+	m->cells.resize((ok)?count:0);
+	m->triangles.resize((ok)?count:0);
+	for (uint32_t i=0; i<count && ok; i++)
+		ok = fread(&m->cells[i], 4, 1, f)==1 && fread(&m->triangles[i], 4, 1, f)==1;
+	fclose(f);
+	if (!ok)
+		gsalt_log(gsalt_verbose_error, "GSalt: %s is not a tiles manifest\n", path);
+	return ok;
+}
+
+static int write_tile(const char *path, const tile_mesh *t)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot write \"%s\"\n", path);
+		return 0;
+	}
+	uint32_t nv = (uint32_t)t->ids.size(), nt = (uint32_t)(t->tris.size()/3);
+	int ok = fwrite(TILE_MAGIC, 8, 1, f)==1 && fwrite(&nv, 4, 1, f)==1 && fwrite(&nt, 4, 1, f)==1
+		&& fwrite(t->ids.data(), 4, nv, f)==nv && fwrite(t->pos.data(), 12, nv, f)==nv
+		&& fwrite(t->lock.data(), 1, nv, f)==nv && fwrite(t->tris.data(), 12, nt, f)==nt;
+	if (fclose(f))
+		ok = 0;
+	if (!ok)
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot write \"%s\"\n", path);
+	return ok;
+}
+
+static int read_tile(const char *path, tile_mesh *t)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot open \"%s\"\n", path);
+		return 0;
+	}
+	char magic[8];
+	uint32_t nv = 0, nt = 0;
+	int ok = fread(magic, 8, 1, f)==1 && !memcmp(magic, TILE_MAGIC, 8) && fread(&nv, 4, 1, f)==1 && fread(&nt, 4, 1, f)==1;
+	if (ok) {
+		t->ids.resize(nv);
+		t->pos.resize((size_t)nv*3);
+		t->lock.resize(nv);
+		t->tris.resize((size_t)nt*3);
+		ok = fread(t->ids.data(), 4, nv, f)==nv && fread(t->pos.data(), 12, nv, f)==nv
+			&& fread(t->lock.data(), 1, nv, f)==nv && fread(t->tris.data(), 12, nt, f)==nt;
+	}
+	fclose(f);
+	for (size_t i=0; i<t->tris.size() && ok; i++)
+		ok = t->tris[i]<nv;
+	if (!ok)
+		gsalt_log(gsalt_verbose_error, "GSalt: %s is not a valid tile\n", path);
+	return ok;
+}
+
+static MxStdModel *tile_model(const tile_mesh *t)
+{
+	size_t nv = t->ids.size(), nt = t->tris.size()/3;
+	MxStdModel *model = new MxStdModel((int)nv, (int)nt);
+	for (size_t i=0; i<nv; i++)
+		model->add_vertex(t->pos[i*3], t->pos[i*3+1], t->pos[i*3+2]);
+	for (size_t i=0; i<nt; i++)
+		model->add_face(t->tris[i*3], t->tris[i*3+1], t->tris[i*3+2]);
+	return model;
+}
+
+int gsalt_tile_split(const char *input, const char *dir, int tiles)
+{
+	gsalt_init();
+	gsalt_log(gsalt_verbose_debug, "GSalt: Split %s in %d tiles per axis in %s\n", (input)?input:"(null)", tiles, (dir)?dir:"(null)");
+	if (!input || !dir || tiles<1) {
+		gsalt_log(gsalt_verbose_error, "GSalt: gsalt_tile_split needs an input, a directory and tiles>0\n");
+		return -1;
+	}
+	double t0 = gsalt_time();
+	ooc_state st;
+	memset(&st, 0, sizeof(st));
+	st.filename = input;
+	scratch sorted;
+	memset(&sorted, 0, sizeof(sorted));
+	std::vector<uint64_t> offsets, counts;
+	tile_manifest m;
+	int ret = -1;
+	if (!read_mesh(&st, input))
+		goto end;
+	if (!scratch_open(&sorted)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot create the scratch files\n");
+		goto end;
+	}
+	if (!sort_cells(&st, tiles, &sorted, offsets, counts))
+		goto end;
+	scratch_close(&st.raw);
+	if (st.grid!=tiles)
+		gsalt_log(gsalt_verbose_warning, "GSalt: %d tiles per axis used instead of %d\n", st.grid, tiles);
+
+	m.grid = st.grid;
+	m.num_vertex = st.num_vertex;
+	m.num_triangles = st.num_triangles;
+	{
+		const float *pos = (const float*)st.pos.data;
+		const unsigned char *bounds = (const unsigned char*)st.bounds.data;
+		const uint32_t *sorted_tris = (const uint32_t*)sorted.data;
+		tile_mesh t;
+		char path[1024];
+		for (size_t c=0; c<counts.size(); c++) {
+			if (!counts[c])
+				continue;
+			const uint32_t *tris = sorted_tris+offsets[c]*3;
+			size_t n = (size_t)counts[c]*3;
+			t.ids.assign(tris, tris+n);
+			std::sort(t.ids.begin(), t.ids.end());
+			t.ids.erase(std::unique(t.ids.begin(), t.ids.end()), t.ids.end());
+			t.pos.resize(t.ids.size()*3);
+			t.lock.assign(t.ids.size(), 0);
+			for (size_t i=0; i<t.ids.size(); i++) {
+				memcpy(&t.pos[i*3], pos+(size_t)t.ids[i]*3, sizeof(float)*3);
+				const unsigned char *b = bounds+(size_t)t.ids[i]*6;
+				t.lock[i] = b[0]!=b[3] || b[1]!=b[4] || b[2]!=b[5];
+			}
+			t.tris.resize(n);
+			for (size_t i=0; i<n; i++)
+				t.tris[i] = (uint32_t)(std::lower_bound(t.ids.begin(), t.ids.end(), tris[i])-t.ids.begin());
+			tile_path(path, sizeof(path), dir, (int)m.cells.size(), "");
+			if (!write_tile(path, &t))
+				goto end;
+			m.cells.push_back((uint32_t)c);
+			m.triangles.push_back((uint32_t)counts[c]);
+		}
+	}
+	if (!write_manifest(dir, &m)) {
+		gsalt_log(gsalt_verbose_error, "GSalt: cannot write the tiles manifest in \"%s\"\n", dir);
+		goto end;
+	}
+	ret = (int)m.cells.size();
+	gsalt_log(gsalt_verbose_debug, "GSalt: %s split in %d tiles (%d^3 grid)\n", input, ret, st.grid);
+
+end:
+	ooc_close(&st);
+	scratch_close(&sorted);
+	gsalt_trace_complete("gsalt_tile_split", t0, gsalt_time());
+	return ret;
+}
+
+int gsalt_tile_simplify(const char *dir, int tile, int objective, unsigned int flags)
+{
+	gsalt_init();
+	gsalt_log(gsalt_verbose_debug, "GSalt: Simplify tile %d of %s, objective %d, flags = %x\n", tile, (dir)?dir:"(null)", objective, flags);
+	tile_manifest m;
+	if (!dir || !read_manifest(dir, &m))
+		return -1;
+	if (tile<0 || tile>=(int)m.cells.size() || objective<0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: tile %d (objective %d) is not valid, %s has %d tiles\n", tile, objective, dir, (int)m.cells.size());
+		return -1;
+	}
+	double t0 = gsalt_time();
+	char path[1024];
+	tile_mesh t;
+	tile_path(path, sizeof(path), dir, tile, "");
+	if (!read_tile(path, &t))
+		return -1;
+
+	// the same ratio in every tile
+	uint64_t target = ((uint64_t)m.triangles[tile]*objective+m.num_triangles-1)/m.num_triangles;
+	MxStdModel *model = tile_model(&t);
+	decimate_locked(model, t.lock.data(), flags&(GSALT_FACE|GSALT_EDGE|GSALT_HALFEDGE), target);
+
+	tile_mesh out;
+	std::vector<uint32_t> vlist;
+	compact_model(model, vlist, out.pos, out.tris);
+	delete model;
+	for (size_t i=0; i<vlist.size(); i++) {
+		out.ids.push_back(t.ids[vlist[i]]);
+		out.lock.push_back(t.lock[vlist[i]]);
+	}
+	tile_path(path, sizeof(path), dir, tile, ".simplified");
+	if (!write_tile(path, &out))
+		return -1;
+	gsalt_trace_complete("gsalt_tile_simplify", t0, gsalt_time());
+	gsalt_log(gsalt_verbose_debug, "GSalt: tile %d simplified from %d to %d triangles\n", tile, (int)(t.tris.size()/3), (int)(out.tris.size()/3));
+	return (int)(out.tris.size()/3);
+}
+
+int gsalt_tile_stitch(const char *dir, const char *output, int format, int objective, unsigned int flags)
+{
+	gsalt_init();
+	gsalt_log(gsalt_verbose_debug, "GSalt: Stitch the tiles of %s to %s, objective %d, flags = %x\n", (dir)?dir:"(null)", (output)?output:"(null)", objective, flags);
+	tile_manifest m;
+	if (!dir || !output || !read_manifest(dir, &m))
+		return -1;
+	if (objective<0) {
+		gsalt_log(gsalt_verbose_error, "GSalt: negative objective (%d)\n", objective);
+		return -1;
+	}
+	double t0 = gsalt_time();
+
+	// all the simplified tiles, in global ids (the shared vertex are in several tiles, at the same place)
+	std::vector<tile_mesh> tiles(m.cells.size());
+	std::vector<uint32_t> ids;
+	char path[1024];
+	for (size_t i=0; i<tiles.size(); i++) {
+		tile_path(path, sizeof(path), dir, (int)i, ".simplified");
+		if (!read_tile(path, &tiles[i])) {
+			gsalt_log(gsalt_verbose_error, "GSalt: tile %d of %s is not simplified\n", (int)i, dir);
+			return -1;
+		}
+		ids.insert(ids.end(), tiles[i].ids.begin(), tiles[i].ids.end());
+	}
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	tile_mesh all;
+	all.pos.resize(ids.size()*3);
+	all.lock.assign(ids.size(), 0);
+	for (size_t i=0; i<tiles.size(); i++) {
+		tile_mesh &t = tiles[i];
+		std::vector<uint32_t> rank(t.ids.size());
+		for (size_t j=0; j<t.ids.size(); j++) {
+			rank[j] = (uint32_t)(std::lower_bound(ids.begin(), ids.end(), t.ids[j])-ids.begin());
+			memcpy(&all.pos[(size_t)rank[j]*3], &t.pos[j*3], sizeof(float)*3);
+			all.lock[rank[j]] |= t.lock[j];
+		}
+		for (size_t j=0; j<t.tris.size(); j++)
+			all.tris.push_back(rank[t.tris[j]]);
+		t = tile_mesh();
+	}
+	all.ids.swap(ids);
+
+	// only the bands along the seams are simplified: the seam vertex and a few rings of triangles around
+	std::vector<unsigned char> band(all.lock), next;
+	for (int r=0; r<TILE_SEAM_RINGS; r++) {
+		next = band;
+		for (size_t i=0; i<all.tris.size(); i+=3)
+			if (band[all.tris[i]] || band[all.tris[i+1]] || band[all.tris[i+2]])
+				next[all.tris[i]] = next[all.tris[i+1]] = next[all.tris[i+2]] = 1;
+		band.swap(next);
+	}
+	for (size_t i=0; i<band.size(); i++)
+		band[i] = !band[i];
+
+	MxStdModel *model = tile_model(&all);
+	size_t before = all.tris.size()/3;
+	all = tile_mesh();
+	decimate_locked(model, band.data(), flags&(GSALT_FACE|GSALT_EDGE|GSALT_HALFEDGE), (uint64_t)objective);
+	std::vector<uint32_t> vlist, tris;
+	std::vector<float> vpos;
+	compact_model(model, vlist, vpos, tris);
+	delete model;
+	if (!write_positions(output, format, vpos, tris))
+		return -1;
+	gsalt_trace_complete("gsalt_tile_stitch", t0, gsalt_time());
+	gsalt_log(gsalt_verbose_warning, "GSalt: Stitched %d tiles of %s from %d to %d triangles\n", (int)m.cells.size(), dir, (int)before, (int)(tris.size()/3));
+	return (int)(tris.size()/3);
+}
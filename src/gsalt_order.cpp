@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gsalt_order.h"
+
+// bits per axis of the Morton code, 1024^3 cells is plenty for memory locality
+#define ORDER_BITS 10
+// the 30 bits codes are sorted in 2 passes of 15 bits
+#define ORDER_RADIX 15
+
+// the 10 low bits of x, 2 zeros between each
+static inline uint32_t spread_bits(uint32_t x)
+{
+	x &= 0x3ff;
+	x = (x | (x<<16)) & 0x030000ff;
+	x = (x | (x<<8)) & 0x0300f00f;
+	x = (x | (x<<4)) & 0x030c30c3;
+	x = (x | (x<<2)) & 0x09249249;
+	return x;
+}
+
+void gsalt_morton_order(const float *points, int n, uint32_t *order)
+{
+	if (n<=0)
+		return;
+	float lo[3], hi[3], scale[3];
+	for (int k=0; k<3; k++)
+		lo[k] = hi[k] = points[k];
+	for (int i=1; i<n; i++)
+		for (int k=0; k<3; k++) {
+			float p = points[i*3+k];
+			if (p<lo[k]) lo[k] = p;
+			if (p>hi[k]) hi[k] = p;
+		}
+	// same scale on every axis, so the cells stay cubes
+	float extent = 0.0f;
+	for (int k=0; k<3; k++)
+		if (hi[k]-lo[k]>extent) extent = hi[k]-lo[k];
+	for (int k=0; k<3; k++)
+		scale[k] = (extent>0.0f)?(float)((1<<ORDER_BITS)-1)/extent:0.0f;
+
+	uint32_t *code = (uint32_t*)malloc(sizeof(uint32_t)*n*2);
+	uint32_t *tmp = (uint32_t*)malloc(sizeof(uint32_t)*n);
+	uint32_t *count = (uint32_t*)malloc(sizeof(uint32_t)*(1<<ORDER_RADIX));
+	uint32_t *code2 = code+n;
+	for (int i=0; i<n; i++) {
+		uint32_t c = 0;
+		for (int k=0; k<3; k++) {
+			float q = (points[i*3+k]-lo[k])*scale[k];	// NaN gives 0
+			c |= spread_bits((q>0.0f)?(uint32_t)q:0)<<k;
+		}
+		code[i] = c;
+		order[i] = i;
+	}
+	// LSD radix sort, stable so equal codes keep the given order
+	uint32_t *src_code = code, *dst_code = code2, *src = order, *dst = tmp;
+	for (int shift=0; shift<ORDER_BITS*3; shift+=ORDER_RADIX) {
+		memset(count, 0, sizeof(uint32_t)*(1<<ORDER_RADIX));
+		for (int i=0; i<n; i++)
+			count[(src_code[i]>>shift)&((1<<ORDER_RADIX)-1)]++;
+		uint32_t sum = 0;
+		for (int b=0; b<(1<<ORDER_RADIX); b++) {
+			uint32_t c = count[b];
+			count[b] = sum;
+			sum += c;
+		}
+		for (int i=0; i<n; i++) {
+			uint32_t p = count[(src_code[i]>>shift)&((1<<ORDER_RADIX)-1)]++;
+			dst_code[p] = src_code[i];
+			dst[p] = src[i];
+		}
+		uint32_t *t = src_code; src_code = dst_code; dst_code = t;
+		t = src; src = dst; dst = t;
+	}
+	if (src!=order)
+		memcpy(order, src, sizeof(uint32_t)*n);
+	free(count);
+	free(tmp);
+	free(code);
+}
+
+void gsalt_face_order(const uint32_t *tris, int num_triangles, const uint32_t *rank, int num_vertex, uint32_t *order)
+{
+	// counting sort on the lowest vertex rank
+	uint32_t *start = (uint32_t*)calloc(num_vertex+1, sizeof(uint32_t));
+	for (int i=0; i<num_triangles; i++) {
+		uint32_t r = rank[tris[i*3]];
+		if (rank[tris[i*3+1]]<r) r = rank[tris[i*3+1]];
+		if (rank[tris[i*3+2]]<r) r = rank[tris[i*3+2]];
+		start[r+1]++;
+	}
+	for (int v=0; v<num_vertex; v++)
+		start[v+1] += start[v];
+	for (int i=0; i<num_triangles; i++) {
+		uint32_t r = rank[tris[i*3]];
+		if (rank[tris[i*3+1]]<r) r = rank[tris[i*3+1]];
+		if (rank[tris[i*3+2]]<r) r = rank[tris[i*3+2]];
+		order[start[r]++] = i;
+	}
+	free(start);
+}
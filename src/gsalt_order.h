@@ -0,0 +1,15 @@
+#ifndef _GSALT_ORDER_H_
+#define _GSALT_ORDER_H_
+
+#include <stdint.h>
+
+// Spatial ordering of a mesh before simplifying, so that neighbour vertex and faces
+// are close in memory too (scanned meshes and many exporters give them in random order).
+
+// order receives the n points (3 floats each) sorted along a Morton curve of their bounding box
+void gsalt_morton_order(const float *points, int n, uint32_t *order);
+
+// order receives the triangles sorted by the lowest rank of their vertex (rank[v] is the new place of v)
+void gsalt_face_order(const uint32_t *tris, int num_triangles, const uint32_t *rank, int num_vertex, uint32_t *order);
+
+#endif //_GSALT_ORDER_H_
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <iterator>
+#include "gsalt_pool.h"
+
+typedef struct {
+	void (*fn)(void *data);
+	void *data;
+} pool_job;
+
+static std::mutex pool_mutex;
+static std::condition_variable pool_work;	// a job was queued, or the workers must quit
+static std::condition_variable pool_done;	// a flag was cleared
+static std::deque<pool_job> pool_jobs;
+static std::vector<std::thread> pool_workers;
+static std::vector<std::thread> pool_retired;	// resized from a job: they quit after it, joined later
+static int pool_size = 0;
+static int pool_generation = 0;	// workers of an older one quit
+static bool pool_quit = false;
+static bool pool_atexit = false;
+static thread_local bool pool_in_worker = false;
+
+static void pool_worker(int generation)
+{
+	pool_in_worker = true;
+	std::unique_lock<std::mutex> lock(pool_mutex);
+	for (;;) {
+		while (!pool_quit && generation==pool_generation && pool_jobs.empty())
+			pool_work.wait(lock);
+		if (pool_quit || generation!=pool_generation)
+			return;
+		pool_job job = pool_jobs.front();
+		pool_jobs.pop_front();
+		lock.unlock();
+		job.fn(job.data);
+		lock.lock();
+	}
+}
+
+// with pool_mutex held
+static void pool_start()
+{
+	int n = pool_size;
+	if (n<=0)
+		n = (int)std::thread::hardware_concurrency();
+	if (n<1)
+		n = 1;
+	for (int i=0; i<n; i++)
+		pool_workers.push_back(std::thread(pool_worker, pool_generation));
+}
+
+// the workers finish their job and quit, the queue is kept
+static void pool_stop()
+{
+	std::vector<std::thread> workers;
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		pool_quit = true;
+		workers.swap(pool_workers);
+		workers.insert(workers.end(), std::make_move_iterator(pool_retired.begin()), std::make_move_iterator(pool_retired.end()));
+		pool_retired.clear();
+	}
+	pool_work.notify_all();
+	for (size_t i=0; i<workers.size(); i++)
+		workers[i].join();
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	pool_quit = false;
+}
+
+// joinable threads can't be destroyed with the statics
+static void pool_exit()
+{
+	pool_stop();
+}
+
+void gsalt_pool_set_threads(int n)
+{
+	if (pool_in_worker) {
+		// can't join itself: retire the workers, new ones take the queue right away
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		pool_size = n;
+		pool_generation++;
+		pool_retired.insert(pool_retired.end(), std::make_move_iterator(pool_workers.begin()), std::make_move_iterator(pool_workers.end()));
+		pool_workers.clear();
+		pool_work.notify_all();
+		if (!pool_jobs.empty())
+			pool_start();
+		return;
+	}
+	pool_stop();
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	pool_size = n;
+	if (!pool_jobs.empty())
+		pool_start();
+}
+
+void gsalt_pool_submit(void (*fn)(void *data), void *data)
+{
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		pool_job job = {fn, data};
+		pool_jobs.push_back(job);
+		if (pool_workers.empty()) {
+			if (!pool_atexit) {
+				atexit(pool_exit);
+				pool_atexit = true;
+			}
+			pool_start();
+		}
+	}
+	pool_work.notify_one();
+}
+
+void gsalt_pool_signal(int *flag)
+{
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		*flag = 0;
+	}
+	pool_done.notify_all();
+}
+
+int gsalt_pool_pending(int *flag)
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	return *flag;
+}
+
+void gsalt_pool_wait(int *flag)
+{
+	std::unique_lock<std::mutex> lock(pool_mutex);
+	while (*flag)
+		pool_done.wait(lock);
+}
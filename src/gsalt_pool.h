@@ -0,0 +1,18 @@
+#ifndef _GSALT_POOL_H_
+#define _GSALT_POOL_H_
+
+// Worker threads shared by every GSalt object, for the asynchronous simplifications.
+// Jobs run in the order they were queued, the threads are started by the first one.
+
+// n threads (0 is one per core). The running jobs are waited for, the queued ones go to the
+// new threads. From a job, the old threads are left to finish theirs instead.
+void gsalt_pool_set_threads(int n);
+void gsalt_pool_submit(void (*fn)(void *data), void *data);
+
+// Completion of a job: the job clears its flag with gsalt_pool_signal, the others read it
+// under the pool lock or sleep until it is cleared.
+void gsalt_pool_signal(int *flag);
+int gsalt_pool_pending(int *flag);
+void gsalt_pool_wait(int *flag);
+
+#endif //_GSALT_POOL_H_
@@ -0,0 +1,24 @@
+#ifndef _GSALT_TIMER_H_
+#define _GSALT_TIMER_H_
+
+// Monotonic wall clock, in seconds
+#ifdef _WIN32
+#include <windows.h>
+static inline double gsalt_time()
+{
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart/(double)freq.QuadPart;
+}
+#else
+#include <time.h>
+static inline double gsalt_time()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+#endif
+
+#endif //_GSALT_TIMER_H_
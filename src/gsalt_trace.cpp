@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <mutex>
+#include "gsalt_trace.h"
+#include "gsalt_timer.h"
+
+#ifdef _WIN32
+#define trace_pid() ((int)GetCurrentProcessId())
+#define trace_tid() ((int)GetCurrentThreadId())
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#define trace_pid() ((int)getpid())
+#define trace_tid() ((int)syscall(SYS_gettid))
+#else
+#include <unistd.h>
+static int trace_next_tid = 0;
+static int trace_tid() {
+	static __thread int tid = 0;
+	if (!tid) tid = __sync_add_and_fetch(&trace_next_tid, 1);
+	return tid;
+}
+#define trace_pid() ((int)getpid())
+#endif
+
+static FILE *trace_file = NULL;
+static int trace_atexit = 0;
+// the file can be changed while simplifications write events on other threads
+static std::mutex trace_mutex;
+
+// Every event is written with a single fprintf under trace_mutex, and ends with ",\n".
+// The closing metadata event is the only one without the comma, so the array stays valid JSON.
+
+// with trace_mutex held
+static void trace_close()
+{
+	if (!trace_file)
+		return;
+	fprintf(trace_file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"gsalt\"}}\n]\n", trace_pid());
+	fclose(trace_file);
+	trace_file = NULL;
+}
+
+int gsalt_trace_open(const char *filename)
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	trace_close();
+	if (!filename || !filename[0])
+		return 1;
+	trace_file = fopen(filename, "w");
+	if (!trace_file)
+		return 0;
+	if (!trace_atexit) {
+		atexit(gsalt_trace_close);
+		trace_atexit = 1;
+	}
+	fprintf(trace_file, "[\n");
+	return 1;
+}
+
+void gsalt_trace_close()
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	trace_close();
+}
+
+int gsalt_trace_enabled()
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	return trace_file!=NULL;
+}
+
+static void trace_event(const char *name, char ph, double t)
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if (!trace_file)
+		return;
+	fprintf(trace_file, "{\"name\": \"%s\", \"cat\": \"gsalt\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d},\n",
+		name, ph, t*1e6, trace_pid(), trace_tid());
+}
+
+void gsalt_trace_begin(const char *name)
+{
+	trace_event(name, 'B', gsalt_time());
+}
+
+void gsalt_trace_end(const char *name)
+{
+	trace_event(name, 'E', gsalt_time());
+}
+
+void gsalt_trace_complete(const char *name, double t0, double t1)
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if (!trace_file)
+		return;
+	fprintf(trace_file, "{\"name\": \"%s\", \"cat\": \"gsalt\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d},\n",
+		name, t0*1e6, (t1-t0)*1e6, trace_pid(), trace_tid());
+}
+
+void gsalt_trace_counter(const char *name, double value)
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if (!trace_file)
+		return;
+	// counters are per process, name them by thread so parallel simplifications don't mix
+	int tid = trace_tid();
+	fprintf(trace_file, "{\"name\": \"%s (%d)\", \"cat\": \"gsalt\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": %d, \"args\": {\"%s\": %g}},\n",
+		name, tid, gsalt_time()*1e6, trace_pid(), name, value);
+}
@@ -0,0 +1,18 @@
+#ifndef _GSALT_TRACE_H_
+#define _GSALT_TRACE_H_
+
+// Chrome trace-event (JSON array) output, loadable in chrome://tracing or Perfetto.
+// Timestamps come from gsalt_time(), each thread gets its own track.
+// Everything is a no-op while no trace file is open.
+
+int gsalt_trace_open(const char *filename);
+void gsalt_trace_close();
+int gsalt_trace_enabled();
+
+void gsalt_trace_begin(const char *name);
+void gsalt_trace_end(const char *name);
+// A phase already measured, from t0 to t1 (in gsalt_time() seconds)
+void gsalt_trace_complete(const char *name, double t0, double t1);
+void gsalt_trace_counter(const char *name, double value);
+
+#endif //_GSALT_TRACE_H_
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "gsalt_vcache.h"
+
+// Tom Forsyth's scoring, with the usual constants
+#define VCACHE_SIZE 32
+#define VCACHE_DECAY_POWER 1.5f
+#define VCACHE_LAST_TRI_SCORE 0.75f
+#define VCACHE_VALENCE_SCALE 2.0f
+#define VCACHE_VALENCE_POWER 0.5f
+#define VCACHE_MAX_VALENCE 64
+
+static float cache_score[VCACHE_SIZE];
+static float valence_score[VCACHE_MAX_VALENCE];
+
+static int fill_scores()
+{
+	for (int i=0; i<VCACHE_SIZE; i++) {
+		if (i<3)
+			cache_score[i] = VCACHE_LAST_TRI_SCORE;
+		else
+			cache_score[i] = powf(1.0f - (float)(i-3)/(float)(VCACHE_SIZE-3), VCACHE_DECAY_POWER);
+	}
+	valence_score[0] = 0.0f;
+	for (int i=1; i<VCACHE_MAX_VALENCE; i++)
+		valence_score[i] = VCACHE_VALENCE_SCALE * powf((float)i, -VCACHE_VALENCE_POWER);
+	return 1;
+}
+
+// once, even with simplifications running on several threads
+static void init_scores()
+{
+	static int scores_inited = fill_scores();
+	(void)scores_inited;
+}
+
+static inline float vertex_score(int cache_pos, int live)
+{
+	if (live==0)
+		return -1.0f;
+	float score = (cache_pos>=0)?cache_score[cache_pos]:0.0f;
+	return score + valence_score[(live<VCACHE_MAX_VALENCE)?live:(VCACHE_MAX_VALENCE-1)];
+}
+
+void gsalt_optimize_vcache(uint32_t *indexes, int num_triangles, int num_vertex)
+{
+	if (num_triangles<2 || num_vertex<3)
+		return;
+
+	init_scores();
+
+	int *live = (int*)calloc(num_vertex, sizeof(int));
+	int *offset = (int*)malloc(sizeof(int)*(num_vertex+1));
+	int *cache_pos = (int*)malloc(sizeof(int)*num_vertex);
+	float *vscore = (float*)malloc(sizeof(float)*num_vertex);
+	uint32_t *adj = (uint32_t*)malloc(sizeof(uint32_t)*num_triangles*3);
+	float *tscore = (float*)malloc(sizeof(float)*num_triangles);
+	char *emitted = (char*)calloc(num_triangles, 1);
+	uint32_t *out = (uint32_t*)malloc(sizeof(uint32_t)*num_triangles*3);
+
+	// triangle adjacency of each vertex
+	for (int i=0; i<num_triangles*3; i++)
+		live[indexes[i]]++;
+	offset[0] = 0;
+	for (int v=0; v<num_vertex; v++) {
+		offset[v+1] = offset[v] + live[v];
+		live[v] = 0;
+		cache_pos[v] = -1;
+	}
+	for (int i=0; i<num_triangles*3; i++) {
+		uint32_t v = indexes[i];
+		adj[offset[v] + live[v]++] = i/3;
+	}
+	for (int v=0; v<num_vertex; v++)
+		vscore[v] = vertex_score(-1, live[v]);
+
+	int best = -1;
+	float best_score = -1.0f;
+	for (int t=0; t<num_triangles; t++) {
+		const uint32_t *tri = indexes+t*3;
+		tscore[t] = vscore[tri[0]] + vscore[tri[1]] + vscore[tri[2]];
+		if (tscore[t]>best_score) {
+			best_score = tscore[t];
+			best = t;
+		}
+	}
+
+	uint32_t cache[VCACHE_SIZE+3];
+	uint32_t new_cache[VCACHE_SIZE+3];
+	int cache_count = 0;
+	int cursor = 0;
+
+	for (int n=0; n<num_triangles; n++) {
+		if (best<0) {
+			// nothing left in the cache, take the next triangle in input order
+			while (emitted[cursor]) cursor++;
+			best = cursor;
+		}
+		const uint32_t *tri = indexes+best*3;
+		memcpy(out+n*3, tri, sizeof(uint32_t)*3);
+		emitted[best] = 1;
+
+		// remove the triangle from the adjacency of its vertex
+		int new_count = 0;
+		for (int k=0; k<3; k++) {
+			uint32_t v = tri[k];
+			uint32_t *list = adj+offset[v];
+			for (int j=0; j<live[v]; j++)
+				if (list[j]==(uint32_t)best) {
+					list[j] = list[--live[v]];
+					break;
+				}
+			int dup = 0;
+			for (int j=0; j<new_count; j++)
+				if (new_cache[j]==v) dup = 1;
+			if (!dup)
+				new_cache[new_count++] = v;
+		}
+		// then shift the LRU cache
+		for (int j=0; j<cache_count; j++) {
+			uint32_t v = cache[j];
+			if (v!=tri[0] && v!=tri[1] && v!=tri[2])
+				new_cache[new_count++] = v;
+		}
+		for (int j=0; j<new_count; j++) {
+			uint32_t v = new_cache[j];
+			cache_pos[v] = (j<VCACHE_SIZE)?j:-1;
+			vscore[v] = vertex_score(cache_pos[v], live[v]);
+		}
+		cache_count = (new_count<VCACHE_SIZE)?new_count:VCACHE_SIZE;
+		memcpy(cache, new_cache, sizeof(uint32_t)*cache_count);
+
+		// rescore the triangles touched by the cache, and pick the best one
+		best = -1;
+		best_score = -1.0f;
+		for (int j=0; j<new_count; j++) {
+			uint32_t v = new_cache[j];
+			for (int a=0; a<live[v]; a++) {
+				uint32_t t = adj[offset[v]+a];
+				const uint32_t *ttri = indexes+t*3;
+				tscore[t] = vscore[ttri[0]] + vscore[ttri[1]] + vscore[ttri[2]];
+				if (tscore[t]>best_score) {
+					best_score = tscore[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	memcpy(indexes, out, sizeof(uint32_t)*num_triangles*3);
+
+	free(out);
+	free(emitted);
+	free(tscore);
+	free(adj);
+	free(vscore);
+	free(cache_pos);
+	free(offset);
+	free(live);
+}
+
+void gsalt_optimize_vfetch(uint32_t *indexes, int num_triangles, int num_vertex, uint32_t *remap)
+{
+	uint32_t next = 0;
+	memset(remap, 0xff, sizeof(uint32_t)*num_vertex);
+	for (int i=0; i<num_triangles*3; i++) {
+		uint32_t v = indexes[i];
+		if (remap[v]==0xffffffff)
+			remap[v] = next++;
+		indexes[i] = remap[v];
+	}
+	for (int v=0; v<num_vertex; v++)
+		if (remap[v]==0xffffffff)
+			remap[v] = next++;
+}
@@ -0,0 +1,16 @@
+#ifndef _GSALT_VCACHE_H_
+#define _GSALT_VCACHE_H_
+
+#include <stdint.h>
+
+// Reorder the triangles of an indexed list for the GPU post-transform cache
+// (Forsyth "Linear-Speed Vertex Cache Optimisation"). Triangles are reordered
+// in place, the vertex numbering is untouched.
+void gsalt_optimize_vcache(uint32_t *indexes, int num_triangles, int num_vertex);
+
+// Build a first-use renumbering of the vertex (for vertex fetch locality).
+// remap[old] receives the new index, unreferenced vertex are put at the end
+// (in their original order). Indexes are rewritten in place.
+void gsalt_optimize_vfetch(uint32_t *indexes, int num_triangles, int num_vertex, uint32_t *remap);
+
+#endif //_GSALT_VCACHE_H_
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <gsalt/gsalt.h>
+#include "gsalt_convert.h"
+#include "gsalt_writer.h"
+
+// vertex and triangles converted at a time
+#define WRITER_BLOCK 256
+// output buffer, written when full. Arrays already in the file layout skip it.
+#define WRITER_BUFFER (1<<20)
+
+typedef struct {
+	FILE *f;
+	char *buf;
+	size_t len;
+	int error;
+} writer;
+
+static void w_flush(writer *w)
+{
+	if (w->len && fwrite(w->buf, 1, w->len, w->f)!=w->len)
+		w->error = 1;
+	w->len = 0;
+}
+
+// room for n more bytes (n <= WRITER_BUFFER)
+static inline char *w_reserve(writer *w, size_t n)
+{
+	if (w->len+n>WRITER_BUFFER)
+		w_flush(w);
+	return w->buf+w->len;
+}
+
+static void w_write(writer *w, const void *p, size_t n)
+{
+	if (n>=WRITER_BUFFER/2) {
+		w_flush(w);
+		if (fwrite(p, 1, n, w->f)!=n)
+			w->error = 1;
+		return;
+	}
+	memcpy(w_reserve(w, n), p, n);
+	w->len += n;
+}
+
+static int w_printf(writer *w, const char *fmt, ...)
+{
+	char *p = w_reserve(w, 256);
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(p, 256, fmt, args);
+	va_end(args);
+	if (n>0 && n<256)
+		w->len += n;
+	return n;
+}
+
+static int host_little_endian()
+{
+	uint16_t one = 1;
+	return *(unsigned char*)&one==1;
+}
+
+static inline void put_le32(char *p, const void *v)
+{
+	memcpy(p, v, 4);
+	if (!host_little_endian()) {
+		char t = p[0]; p[0] = p[3]; p[3] = t;
+		t = p[1]; p[1] = p[2]; p[2] = t;
+	}
+}
+
+// a block of triangles as uint32, from the indexes or the flat list
+static void get_triangles(uint32_t *dst, int first, int count, const void *indexes, int index_type, int index_stride)
+{
+	for (int i=0; i<count; i++) {
+		int t = first+i;
+		for (int k=0; k<3; k++) {
+			if (!indexes)
+				dst[i*3+k] = t*3+k;
+			else if (index_type==GSALT_UINT16)
+				dst[i*3+k] = ((const uint16_t*)indexes)[t*3*index_stride+k];
+			else
+				dst[i*3+k] = ((const uint32_t*)indexes)[t*3*index_stride+k];
+		}
+	}
+}
+
+// n floats of each vertex of a block, 4 floats apart
+static void get_attrib(float *dst, int n, const gsalt_array_view *a, int first, int count)
+{
+	gsalt_decode(dst, 4, n, a->ptr+(size_t)first*a->stride, a->stride, a->type, a->size, count);
+}
+
+static void write_ply(writer *w, int num_vertex, const gsalt_array_view *arrays, int num_triangles, const void *indexes, int index_type, int index_stride)
+{
+	const gsalt_array_view *vertex = arrays, *color = arrays+1, *normal = arrays+2, *texcoord = arrays+3;
+	// native order, every reader swaps as needed
+	w_printf(w, "ply\nformat %s 1.0\ncomment written by GSalt\n", (host_little_endian())?"binary_little_endian":"binary_big_endian");
+	w_printf(w, "element vertex %d\nproperty float x\nproperty float y\nproperty float z\n", num_vertex);
+	if (normal->ptr)
+		w_printf(w, "property float nx\nproperty float ny\nproperty float nz\n");
+	if (color->ptr)
+		w_printf(w, "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n");
+	if (texcoord->ptr)
+		w_printf(w, "property float s\nproperty float t\n");
+	w_printf(w, "element face %d\nproperty list uchar uint vertex_indices\nend_header\n", num_triangles);
+
+	if (!color->ptr && !normal->ptr && !texcoord->ptr && vertex->type==GSALT_FLOAT && vertex->size==3 && vertex->stride==12) {
+		// already the PLY vertex layout
+		w_write(w, vertex->ptr, (size_t)num_vertex*12);
+	} else {
+		float block[4][WRITER_BLOCK*4];
+		int record = 12+((normal->ptr)?12:0)+((color->ptr)?4:0)+((texcoord->ptr)?8:0);
+		for (int first=0; first<num_vertex; first+=WRITER_BLOCK) {
+			int count = (num_vertex-first<WRITER_BLOCK)?(num_vertex-first):WRITER_BLOCK;
+			get_attrib(block[0], 3, vertex, first, count);
+			if (normal->ptr) get_attrib(block[2], 3, normal, first, count);
+			if (color->ptr) get_attrib(block[1], 4, color, first, count);
+			if (texcoord->ptr) get_attrib(block[3], 2, texcoord, first, count);
+			char *p = w_reserve(w, (size_t)record*count);
+			for (int i=0; i<count; i++) {
+				memcpy(p, block[0]+i*4, 12); p += 12;
+				if (normal->ptr) { memcpy(p, block[2]+i*4, 12); p += 12; }
+				if (color->ptr) { gsalt_encode(p, 4, GSALT_UNSIGNED_BYTE_NORM, 4, block[1]+i*4, 4, 1); p += 4; }
+				if (texcoord->ptr) { memcpy(p, block[3]+i*4, 8); p += 8; }
+			}
+			w->len += (size_t)record*count;
+		}
+	}
+
+	uint32_t tris[WRITER_BLOCK*3];
+	for (int first=0; first<num_triangles; first+=WRITER_BLOCK) {
+		int count = (num_triangles-first<WRITER_BLOCK)?(num_triangles-first):WRITER_BLOCK;
+		get_triangles(tris, first, count, indexes, index_type, index_stride);
+		char *p = w_reserve(w, (size_t)13*count);
+		for (int i=0; i<count; i++, p+=13) {
+			p[0] = 3;
+			memcpy(p+1, tris+i*3, 12);
+		}
+		w->len += (size_t)13*count;
+	}
+}
+
+static void write_stl(writer *w, int num_vertex, const gsalt_array_view *arrays, int num_triangles, const void *indexes, int index_type, int index_stride)
+{
+	char header[84];
+	memset(header, 0, sizeof(header));
+	strcpy(header, "binary STL written by GSalt");
+	uint32_t n = num_triangles;
+	put_le32(header+80, &n);
+	w_write(w, header, sizeof(header));
+
+	// the corners are gathered from the vertex array, so decode the triangles of a block one vertex at a time
+	const gsalt_array_view *vertex = arrays;
+	uint32_t tris[WRITER_BLOCK*3];
+	float corner[4];
+	for (int first=0; first<num_triangles; first+=WRITER_BLOCK) {
+		int count = (num_triangles-first<WRITER_BLOCK)?(num_triangles-first):WRITER_BLOCK;
+		get_triangles(tris, first, count, indexes, index_type, index_stride);
+		char *p = w_reserve(w, (size_t)50*count);
+		for (int i=0; i<count; i++, p+=50) {
+			float v[3][3];
+			for (int k=0; k<3; k++) {
+				get_attrib(corner, 3, vertex, tris[i*3+k], 1);
+				memcpy(v[k], corner, sizeof(v[k]));
+			}
+			float e1[3], e2[3], nrm[3];
+			for (int k=0; k<3; k++) {
+				e1[k] = v[1][k]-v[0][k];
+				e2[k] = v[2][k]-v[0][k];
+			}
+			nrm[0] = e1[1]*e2[2]-e1[2]*e2[1];
+			nrm[1] = e1[2]*e2[0]-e1[0]*e2[2];
+			nrm[2] = e1[0]*e2[1]-e1[1]*e2[0];
+			float l = sqrtf(nrm[0]*nrm[0]+nrm[1]*nrm[1]+nrm[2]*nrm[2]);
+			for (int k=0; k<3; k++) {
+				float c = (l>0.0f)?nrm[k]/l:0.0f;
+				put_le32(p+k*4, &c);
+			}
+			for (int j=0; j<3; j++)
+				for (int k=0; k<3; k++)
+					put_le32(p+12+j*12+k*4, &v[j][k]);
+			p[48] = p[49] = 0;
+		}
+		w->len += (size_t)50*count;
+	}
+}
+
+static void write_obj(writer *w, int num_vertex, const gsalt_array_view *arrays, int num_triangles, const void *indexes, int index_type, int index_stride)
+{
+	const gsalt_array_view *vertex = arrays, *color = arrays+1, *normal = arrays+2, *texcoord = arrays+3;
+	w_printf(w, "# written by GSalt\n");
+	float block[WRITER_BLOCK*4], extra[WRITER_BLOCK*4];
+	// %.9g gives back the same float when read
+	for (int first=0; first<num_vertex; first+=WRITER_BLOCK) {
+		int count = (num_vertex-first<WRITER_BLOCK)?(num_vertex-first):WRITER_BLOCK;
+		get_attrib(block, 3, vertex, first, count);
+		if (color->ptr) {
+			get_attrib(extra, 3, color, first, count);
+			for (int i=0; i<count; i++)
+				w_printf(w, "v %.9g %.9g %.9g %.6g %.6g %.6g\n", block[i*4], block[i*4+1], block[i*4+2], extra[i*4], extra[i*4+1], extra[i*4+2]);
+		} else
+			for (int i=0; i<count; i++)
+				w_printf(w, "v %.9g %.9g %.9g\n", block[i*4], block[i*4+1], block[i*4+2]);
+	}
+	if (texcoord->ptr)
+		for (int first=0; first<num_vertex; first+=WRITER_BLOCK) {
+			int count = (num_vertex-first<WRITER_BLOCK)?(num_vertex-first):WRITER_BLOCK;
+			get_attrib(block, 2, texcoord, first, count);
+			for (int i=0; i<count; i++)
+				w_printf(w, "vt %.9g %.9g\n", block[i*4], block[i*4+1]);
+		}
+	if (normal->ptr)
+		for (int first=0; first<num_vertex; first+=WRITER_BLOCK) {
+			int count = (num_vertex-first<WRITER_BLOCK)?(num_vertex-first):WRITER_BLOCK;
+			get_attrib(block, 3, normal, first, count);
+			for (int i=0; i<count; i++)
+				w_printf(w, "vn %.9g %.9g %.9g\n", block[i*4], block[i*4+1], block[i*4+2]);
+		}
+
+	uint32_t tris[WRITER_BLOCK*3];
+	for (int first=0; first<num_triangles; first+=WRITER_BLOCK) {
+		int count = (num_triangles-first<WRITER_BLOCK)?(num_triangles-first):WRITER_BLOCK;
+		get_triangles(tris, first, count, indexes, index_type, index_stride);
+		for (int i=0; i<count; i++) {
+			uint32_t *t = tris+i*3;
+			if (texcoord->ptr && normal->ptr)
+				w_printf(w, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", t[0]+1, t[0]+1, t[0]+1, t[1]+1, t[1]+1, t[1]+1, t[2]+1, t[2]+1, t[2]+1);
+			else if (texcoord->ptr)
+				w_printf(w, "f %u/%u %u/%u %u/%u\n", t[0]+1, t[0]+1, t[1]+1, t[1]+1, t[2]+1, t[2]+1);
+			else if (normal->ptr)
+				w_printf(w, "f %u//%u %u//%u %u//%u\n", t[0]+1, t[0]+1, t[1]+1, t[1]+1, t[2]+1, t[2]+1);
+			else
+				w_printf(w, "f %u %u %u\n", t[0]+1, t[1]+1, t[2]+1);
+		}
+	}
+}
+
+int gsalt_write_mesh(const char *filename, int format, int num_vertex, const gsalt_array_view *arrays,
+	int num_triangles, const void *indexes, int index_type, int index_stride)
+{
+	writer w;
+	w.f = fopen(filename, "wb");
+	if (!w.f)
+		return 0;
+	w.buf = (char*)malloc(WRITER_BUFFER);
+	w.len = 0;
+	w.error = 0;
+	switch (format) {
+		case GSALT_FILE_PLY: write_ply(&w, num_vertex, arrays, num_triangles, indexes, index_type, index_stride); break;
+		case GSALT_FILE_STL: write_stl(&w, num_vertex, arrays, num_triangles, indexes, index_type, index_stride); break;
+		default: write_obj(&w, num_vertex, arrays, num_triangles, indexes, index_type, index_stride); break;
+	}
+	w_flush(&w);
+	free(w.buf);
+	if (fclose(w.f))
+		w.error = 1;
+	return !w.error;
+}
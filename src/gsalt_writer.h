@@ -0,0 +1,19 @@
+#ifndef _GSALT_WRITER_H_
+#define _GSALT_WRITER_H_
+
+// Binary PLY, binary STL and OBJ output of an indexed mesh, through large buffered writes.
+// The arrays are in any of the gsalt_array_* types, and are converted a block at a time.
+
+typedef struct {
+	const char *ptr;	// NULL if the attribute is not there
+	int type;
+	int size;
+	int stride;			// in bytes
+} gsalt_array_view;
+
+// arrays are vertex, color, normal, texcoord. indexes is NULL for a flat list of triangles
+// (vertex 3*i, 3*i+1, 3*i+2), index_stride is in triangles. Gives back 0 if the file could not be written.
+int gsalt_write_mesh(const char *filename, int format, int num_vertex, const gsalt_array_view *arrays,
+	int num_triangles, const void *indexes, int index_type, int index_stride);
+
+#endif //_GSALT_WRITER_H_
@@ -86,6 +86,16 @@ public:
     unsigned int normal_count() const { return (normals?normals->length():0); }
     uint texcoord_count() const { return (tcoords?tcoords->length():0); }
 
+    size_t memory_usage() const
+	{
+	    size_t bytes = vertices.total_space()*sizeof(MxVertex)
+		+ faces.total_space()*sizeof(MxFace);
+	    if( normals ) bytes += normals->total_space()*sizeof(MxNormal);
+	    if( colors ) bytes += colors->total_space()*sizeof(MxColor);
+	    if( tcoords ) bytes += tcoords->total_space()*sizeof(MxTexCoord);
+	    return bytes;
+	}
+
     MxVertexID add_vertex(float, float, float);
     MxFaceID add_face(uint, uint, uint, bool will_link=true);
     unsigned int add_color(float, float, float, float=1.0f);
@@ -0,0 +1,294 @@
+/************************************************************************
+
+  Compact index based half-edge connectivity for triangle meshes.
+
+ ************************************************************************/
+
+#include "stdmix.h"
+#include "MxHalfEdge.h"
+
+MxHalfEdgeModel::MxHalfEdgeModel(uint nvert, uint nface)
+    : corner(3*nface), twins(3*nface), outgoing(nvert), degree(nvert),
+      v_flags(nvert), f_flags(nface), ring(nvert)
+{
+}
+
+size_t MxHalfEdgeModel::memory_usage() const
+{
+    return corner.length()*(sizeof(MxVertexID)+sizeof(MxHalfEdgeID))
+	+ outgoing.length()*(sizeof(MxHalfEdgeID)+sizeof(uint)+1)
+	+ f_flags.length()
+	+ ring.memory_usage();
+}
+
+//
+// Walk clockwise from start to the outgoing half-edge with no twin, so
+// that walking counterclockwise from out(v) covers the whole fan.
+//
+void MxHalfEdgeModel::fix_outgoing(MxVertexID v, MxHalfEdgeID start)
+{
+    MxHalfEdgeID h = start;
+    for(;;)
+    {
+	MxHalfEdgeID t = twins(h);
+	if( t==MXID_NIL )  break;
+	h = next(t);
+	if( h==start )  break;
+    }
+    outgoing(v) = h;
+}
+
+bool MxHalfEdgeModel::build(MxStdModel& m)
+{
+    uint nv = outgoing.length(), nh = corner.length();
+    MxHalfEdgeID h;
+    MxVertexID v;
+    uint i, j;
+
+    for(MxFaceID f=0; f<nh/3; f++)
+    {
+	MxFace& t = m.face(f);
+	f_flags(f) = m.face_is_valid(f)?1:0;
+	for(j=0; j<3; j++)
+	{
+	    corner(3*f+j) = t[j];
+	    twins(3*f+j) = MXID_NIL;
+	}
+	if( f_flags(f) && (t[0]==t[1] || t[1]==t[2] || t[0]==t[2]) )
+	    return false;
+    }
+
+    //
+    // Pair the half-edges through buckets on their lowest vertex
+    MxBlock<uint> first(nv+1), bucket(nh);
+    for(v=0; v<=nv; v++)  first(v) = 0;
+    for(h=0; h<nh; h++)
+	if( f_flags(face(h)) )
+	    first(MIN(origin(h), target(h))+1)++;
+    for(v=0; v<nv; v++)  first(v+1) += first(v);
+    for(h=0; h<nh; h++)
+	if( f_flags(face(h)) )
+	    bucket(first(MIN(origin(h), target(h)))++) = h;
+    for(v=nv; v>0; v--)  first(v) = first(v-1);
+    first(0) = 0;
+
+    for(v=0; v<nv; v++)
+	for(i=first(v); i<first(v+1); i++)
+	{
+	    MxHalfEdgeID a = bucket(i);
+	    MxVertexID a_far = MAX(origin(a), target(a));
+	    for(j=i+1; j<first(v+1); j++)
+	    {
+		MxHalfEdgeID b = bucket(j);
+		if( MAX(origin(b), target(b))!=a_far )  continue;
+
+		// a third face, or two faces with the same orientation
+		if( twins(a)!=MXID_NIL || twins(b)!=MXID_NIL
+		    || origin(a)==origin(b) )
+		    return false;
+		twins(a) = b;
+		twins(b) = a;
+	    }
+	}
+
+    //
+    // Outgoing half-edges, and vertices with more than one fan
+    for(v=0; v<nv; v++)  { outgoing(v) = MXID_NIL;  degree(v) = 0; }
+    for(h=0; h<nh; h++)
+	if( f_flags(face(h)) )
+	{
+	    outgoing(origin(h)) = h;
+	    degree(origin(h))++;
+	}
+    for(v=0; v<nv; v++)
+    {
+	v_flags(v) = 0;
+	if( outgoing(v)==MXID_NIL )  continue;
+	fix_outgoing(v, outgoing(v));
+
+	MxHalfEdgeID h0 = outgoing(v);
+	uint n = 0;
+	h = h0;
+	do { n++;  h = next_out(h); } while( h!=MXID_NIL && h!=h0 );
+	if( n!=degree(v) )  v_flags(v) = 1;
+    }
+
+    return true;
+}
+
+void MxHalfEdgeModel::collect_edges(MxVertexID v,
+				    MxDynBlock<MxHalfEdgeID>& edges) const
+{
+    MxHalfEdgeID h0 = outgoing(v), h = h0, last = h0;
+
+    if( h0==MXID_NIL )  return;
+    do { edges.add(h);  last = h;  h = next_out(h); }
+    while( h!=MXID_NIL && h!=h0 );
+
+    // The boundary edge closing the fan only comes into v
+    if( h==MXID_NIL )  edges.add(prev(last));
+}
+
+void MxHalfEdgeModel::mark_ring(MxVertexID v)
+{
+    MxHalfEdgeID h0 = outgoing(v), h = h0, last = h0;
+
+    if( h0==MXID_NIL )  return;
+    do { ring.mark(target(h));  last = h;  h = next_out(h); }
+    while( h!=MXID_NIL && h!=h0 );
+
+    if( h==MXID_NIL )  ring.mark(origin(prev(last)));
+}
+
+// Searches the smaller of the two fans
+bool MxHalfEdgeModel::is_adjacent(MxVertexID u, MxVertexID w) const
+{
+    if( degree(w) < degree(u) )  { MxVertexID t = u;  u = w;  w = t; }
+
+    MxHalfEdgeID h0 = outgoing(u), h = h0, last = h0;
+    if( h0==MXID_NIL )  return false;
+    do
+    {
+	if( target(h)==w )  return true;
+	last = h;
+	h = next_out(h);
+    } while( h!=MXID_NIL && h!=h0 );
+
+    return h==MXID_NIL && origin(prev(last))==w;
+}
+
+//
+// The link condition: the vertices adjacent to both ends must be the
+// opposite corners of the faces of the edge, otherwise the collapse
+// would fold the surface onto itself.
+//
+bool MxHalfEdgeModel::check_link(MxHalfEdgeID h)
+{
+    MxVertexID a = origin(h), b = target(h);
+    MxHalfEdgeID t = twins(h);
+
+    if( vertex_is_frozen(a) || vertex_is_frozen(b) )  return false;
+
+    // An interior edge between two boundaries would pinch the surface
+    if( t!=MXID_NIL && is_boundary(a) && is_boundary(b) )  return false;
+
+    MxVertexID x = origin(prev(h));
+    MxVertexID y = (t!=MXID_NIL)?origin(prev(t)):MXID_NIL;
+    if( x==y )  return false;
+
+    // Walk the small fan, and look for the other end around each of
+    // its vertices rather than marking a fan of high valence.
+    if( degree(b) < degree(a) )  { MxVertexID s = a;  a = b;  b = s; }
+    bool by_marks = degree(b) <= 2*degree(a) + 8;
+
+    if( by_marks )
+    {
+	ring.next();
+	mark_ring(b);
+    }
+
+    MxHalfEdgeID h0 = outgoing(a), g = h0, last = h0;
+    do
+    {
+	MxVertexID u = target(g);
+	if( u!=b && u!=x && u!=y &&
+	    (by_marks?ring.is_marked(u):is_adjacent(u, b)) )
+	    return false;
+	last = g;
+	g = next_out(g);
+    } while( g!=MXID_NIL && g!=h0 );
+
+    if( g==MXID_NIL )
+    {
+	MxVertexID u = origin(prev(last));
+	if( u!=b && u!=x && u!=y &&
+	    (by_marks?ring.is_marked(u):is_adjacent(u, b)) )
+	    return false;
+    }
+
+    return true;
+}
+
+void MxHalfEdgeModel::collapse(MxHalfEdgeID h, MxVertexID keep,
+			       MxHalfEdgeCollapse& conx)
+{
+    MxVertexID gone = (origin(h)==keep)?target(h):origin(h);
+    MxHalfEdgeID sides[2] = { h, twins(h) };
+    MxHalfEdgeID out_kept = outgoing(keep), out_gone = outgoing(gone);
+    bool boundary = is_boundary(keep) || is_boundary(gone);
+    MxHalfEdgeID g;
+    uint i;
+
+    conx.v_kept = keep;
+    conx.v_removed = gone;
+    conx.dead_count = 0;
+
+    // The walk only follows twins, so relabel before they change
+    g = out_gone;
+    do { corner(g) = keep;  g = next_out(g); } while( g!=MXID_NIL && g!=out_gone );
+    outgoing(gone) = MXID_NIL;
+    degree(keep) += degree(gone);
+    degree(gone) = 0;
+
+    for(i=0; i<2; i++)
+    {
+	MxHalfEdgeID e = sides[i];
+	if( e==MXID_NIL )  continue;
+
+	uint k = conx.dead_count++;
+	MxHalfEdgeID en = next(e), ep = prev(e);
+	MxHalfEdgeID p = twins(en), q = twins(ep);
+
+	if( p!=MXID_NIL )  twins(p) = q;
+	if( q!=MXID_NIL )  twins(q) = p;
+
+	conx.dead[k] = face(e);
+	conx.gone[k][0] = en;  conx.gone[k][1] = ep;
+	conx.glued[k][0] = p;  conx.glued[k][1] = q;
+	f_flags(face(e)) = 0;
+    }
+
+    //
+    // p runs from the opposite corner x to keep, q from keep to x.  The
+    // only outgoing half-edge x loses is ep, and p takes its place (and
+    // its lack of twin on the boundary).
+    MxHalfEdgeID start[6];
+    uint n = 0;
+    start[n++] = out_kept;
+    start[n++] = out_gone;
+    for(i=0; i<conx.dead_count; i++)
+    {
+	MxHalfEdgeID p = conx.glued[i][0], q = conx.glued[i][1];
+	MxHalfEdgeID ep = conx.gone[i][1];
+	MxVertexID x = origin(ep);
+
+	if( outgoing(x)==ep )  outgoing(x) = p;
+	degree(x)--;
+	degree(keep) -= 2;
+
+	if( q!=MXID_NIL )  start[n++] = q;
+	if( p!=MXID_NIL )  start[n++] = next(p);
+
+	twins(conx.gone[i][0]) = twins(ep) = MXID_NIL;
+    }
+    twins(sides[0]) = MXID_NIL;
+    if( sides[1]!=MXID_NIL )  twins(sides[1]) = MXID_NIL;
+
+    //
+    // Any live half-edge out of an interior vertex will do.  On the
+    // boundary it must be the one without twin, that is usually still
+    // there: only walk the fan when it is not.
+    outgoing(keep) = MXID_NIL;
+    for(i=0; i<n; i++)
+	if( f_flags(face(start[i])) )
+	{
+	    if( !boundary || twins(start[i])==MXID_NIL )
+	    {
+		outgoing(keep) = start[i];
+		break;
+	    }
+	    if( outgoing(keep)==MXID_NIL )  outgoing(keep) = start[i];
+	}
+    if( boundary && outgoing(keep)!=MXID_NIL && twins(outgoing(keep))!=MXID_NIL )
+	fix_outgoing(keep, outgoing(keep));
+}
@@ -0,0 +1,91 @@
+#ifndef MXHALFEDGE_INCLUDED // -*- C++ -*-
+#define MXHALFEDGE_INCLUDED
+#if !defined(__GNUC__)
+#  pragma once
+#endif
+
+/************************************************************************
+
+  Compact index based half-edge connectivity for triangle meshes.
+
+  Half-edge h belongs to face h/3 and runs from corner h to corner
+  next(h), so next, prev and face are implicit.  Only the origin of
+  every half-edge, its twin, and one outgoing half-edge and the face
+  count of every vertex are stored.  Edge collapses only walk the fan
+  of the removed vertex, and are guarded by the link condition.
+
+ ************************************************************************/
+
+#include "MxStdModel.h"
+
+typedef uint MxHalfEdgeID;
+
+//
+// What a collapse did to the half-edges around it.  For each dead face,
+// its two other sides are gone and their twins (MXID_NIL on the
+// boundary) are now twins of each other.
+//
+class MxHalfEdgeCollapse
+{
+public:
+    MxVertexID v_kept, v_removed;
+    uint dead_count;
+    MxFaceID dead[2];
+    MxHalfEdgeID gone[2][2];
+    MxHalfEdgeID glued[2][2];
+};
+
+class MxHalfEdgeModel
+{
+private:
+    MxBlock<MxVertexID> corner;      // origin of each half-edge
+    MxBlock<MxHalfEdgeID> twins;     // MXID_NIL on the boundary
+    MxBlock<MxHalfEdgeID> outgoing;  // first one counterclockwise, MXID_NIL if isolated
+    MxBlock<uint> degree;            // faces around each vertex
+    MxBlock<unsigned char> v_flags;
+    MxBlock<unsigned char> f_flags;
+    MxVertexStamps ring;
+
+    void fix_outgoing(MxVertexID v, MxHalfEdgeID start);
+    void mark_ring(MxVertexID v);
+    bool is_adjacent(MxVertexID u, MxVertexID w) const;
+
+public:
+    MxHalfEdgeModel(uint nvert, uint nface);
+
+    // Gives back false on degenerate faces, edges with more than two
+    // faces, or two faces that disagree on the orientation.
+    bool build(MxStdModel& m);
+    size_t memory_usage() const;
+
+    static MxHalfEdgeID next(MxHalfEdgeID h) { return (h%3==2)?h-2:h+1; }
+    static MxHalfEdgeID prev(MxHalfEdgeID h) { return (h%3==0)?h+2:h-1; }
+    static MxFaceID face(MxHalfEdgeID h) { return h/3; }
+
+    MxVertexID origin(MxHalfEdgeID h) const { return corner(h); }
+    MxVertexID target(MxHalfEdgeID h) const { return corner(next(h)); }
+    MxHalfEdgeID twin(MxHalfEdgeID h) const { return twins(h); }
+    MxHalfEdgeID out(MxVertexID v) const { return outgoing(v); }
+
+    // Next outgoing half-edge counterclockwise around origin(h):
+    // MXID_NIL after the last one of a boundary vertex, out() again
+    // after the last one of an interior vertex.
+    MxHalfEdgeID next_out(MxHalfEdgeID h) const { return twins(prev(h)); }
+
+    uint half_edge_count() const { return corner.length(); }
+    bool face_is_valid(MxFaceID f) const { return f_flags(f)!=0; }
+    // Non-manifold vertices (several fans) are never collapsed
+    bool vertex_is_frozen(MxVertexID v) const { return v_flags(v)!=0; }
+    bool is_boundary(MxVertexID v) const
+	{ MxHalfEdgeID h=outgoing(v);  return h!=MXID_NIL && twins(h)==MXID_NIL; }
+
+    // One half-edge of every edge around v
+    void collect_edges(MxVertexID v, MxDynBlock<MxHalfEdgeID>& edges) const;
+    uint face_degree(MxVertexID v) const { return degree(v); }
+
+    bool check_link(MxHalfEdgeID h);
+    void collapse(MxHalfEdgeID h, MxVertexID keep, MxHalfEdgeCollapse& conx);
+};
+
+// MXHALFEDGE_INCLUDED
+#endif
@@ -60,6 +60,7 @@ public:
     void update(MxHeapable *, float);
 
     unsigned int size() const { return length(); }
+    size_t memory_usage() const { return total_space()*sizeof(MxHeapable *); }
     MxHeapable       *item(uint i)       { return (*this)[i]; }
     const MxHeapable *item(uint i) const { return (*this)[i]; }
     MxHeapable *extract();
@@ -11,13 +11,16 @@
 #include "stdmix.h"
 #include "MxPropSlim.h"
 #include "MxGeom3D.h"
+#include "../gsalt_timer.h"
+#include "../gsalt_trace.h"
 
 typedef MxQuadric Quadric;
 
 MxPropSlim::MxPropSlim(MxStdModel &m0)
     : MxStdSlim(&m0),
       __quadrics(m0.vert_count()),
-      edge_links(m0.vert_count())
+      edge_links(m0.vert_count()),
+      star(m0.vert_count())
 {
     consider_color();
     consider_texture();
@@ -26,6 +29,27 @@ MxPropSlim::MxPropSlim(MxStdModel &m0)
     D = compute_dimension(m);
 
     will_decouple_quadrics = false;
+
+    for(uint j=0; j<__quadrics.length(); j++)
+	__quadrics[j] = NULL;
+}
+
+MxPropSlim::~MxPropSlim()
+{
+    // Edges out of the heap (between two locked vertices) are only in the links
+    for(uint i=0; i<edge_links.length(); i++)
+	for(uint j=0; j<edge_links(i).length(); j++)
+	{
+	    edge_info *e = edge_links(i)(j);
+	    // each is in the links of both ends, freed at the last one
+	    if( !e->is_in_heap() && i==MAX(e->v1, e->v2) )  delete e;
+	}
+
+    for(uint i=0; i<heap.size(); i++)
+	delete ((edge_info *)heap.item(i));
+
+    for(uint j=0; j<__quadrics.length(); j++)
+	delete __quadrics[j];
 }
 
 void MxPropSlim::consider_color(bool will)
@@ -290,19 +314,50 @@ void MxPropSlim::collect_quadrics()
 
 void MxPropSlim::initialize()
 {
+    double t0 = gsalt_time();
     collect_quadrics();
+    double t1 = gsalt_time();
 
     if( boundary_weight > 0.0 )
  	constrain_boundaries();
-
+    double t2 = gsalt_time();
 
     collect_edges();
-
+    double t3 = gsalt_time();
+
+    time_quadrics = t1 - t0;
+    time_boundaries = t2 - t1;
+    time_edges = t3 - t2;
+    gsalt_trace_complete("collect_quadrics", t0, t1);
+    gsalt_trace_complete("constrain_boundaries", t1, t2);
+    gsalt_trace_complete("collect_edges", t2, t3);
     is_initialized = true;
 }
 
+size_t MxPropSlim::memory_usage()
+{
+    // every live edge is in the heap
+    size_t bytes = MxStdSlim::memory_usage()
+	+ __quadrics.length()*(sizeof(MxQuadric *) + sizeof(MxQuadric)
+			       + (D*D + D)*sizeof(real))
+	+ edge_links.length()*sizeof(edge_list)
+	+ heap.size()*(sizeof(edge_info) + D*sizeof(real))
+	+ star.memory_usage();
+
+    for(uint i=0; i<edge_links.length(); i++)
+	bytes += edge_links(i).total_space()*sizeof(edge_info *);
+
+    return bytes;
+}
+
 void MxPropSlim::compute_target_placement(edge_info *info)
 {
+    // A locked vertex is always the one kept, and stays where it is
+    if( vertex_is_locked(info->v2) )
+    {
+        MxVertexID t = info->v1;  info->v1 = info->v2;  info->v2 = t;
+        uint s = info->slot1;  info->slot1 = info->slot2;  info->slot2 = s;
+    }
     MxVertexID i=info->v1, j=info->v2;
 
     const MxQuadric &Qi=quadric(i), &Qj=quadric(j);
@@ -310,13 +365,19 @@ void MxPropSlim::compute_target_placement(edge_info *info)
 
     real err;
 
-    if( Q.optimize(info->target) )
+    if( vertex_is_locked(i) )
+    {
+        pack_to_vector(i, info->target);
+        err = Q(info->target);
+    }
+    else if( Q.optimize(info->target) )
     {
 	err = Q(info->target);
     }
     else
     {
 	// Fall back only on endpoints
+	optimize_fallbacks++;
 
 	MxVector v_i(dim()), v_j(dim());
 
@@ -347,10 +408,11 @@ bool MxPropSlim::decimate(uint target)
 {
     MxPairContraction conx;
 
-    while( valid_faces > target )
+    while( valid_faces > target && !stopped && !error_limit_reached() )
     {
 	edge_info *info = (edge_info *)heap.extract();
 	if( !info )  return false;
+	heap_extracts++;
 
 	MxVertexID v1=info->v1, v2=info->v2;
 
@@ -366,7 +428,11 @@ bool MxPropSlim::decimate(uint target)
 	    conx.dv2[Z] = info->target[Z] - m->vertex(v2)[Z];
 
 	    apply_contraction(conx, info);
+
+	    record_contraction(-info->heap_key());
 	}
+	else
+	    stale_extracts++;
 
 	delete info;
     }
@@ -382,14 +448,16 @@ bool MxPropSlim::decimate(uint target)
 
 void MxPropSlim::create_edge(MxVertexID i, MxVertexID j)
 {
-    edge_info *info = new edge_info(dim());
+    if( vertex_is_locked(i) && vertex_is_locked(j) )  return;
 
-    edge_links(i).add(info);
-    edge_links(j).add(info);
+    edge_info *info = new edge_info(dim());
 
     info->v1 = i;
     info->v2 = j;
 
+    link_edge(i, info);
+    link_edge(j, info);
+
     compute_edge_info(info);
 }
 
@@ -450,14 +518,18 @@ void MxPropSlim::collect_edges()
 {
     MxVertexList star;
 
+    // The stars of locked vertices are never walked: their edges to
+    // unlocked neighbours are added from the other end.
     for(MxVertexID i=0; i<m->vert_count(); i++)
     {
+        if( vertex_is_locked(i) )  continue;
+
         star.reset();
         m->collect_vertex_star(i, star);
 
         for(uint j=0; j<star.length(); j++)
-            if( i < star(j) )  // Only add particular edge once
-                create_edge(i, star(j));
+            if( i < star(j) || vertex_is_locked(star(j)) )
+                create_edge(i, star(j));  // Only add particular edge once
     }
 }
 
@@ -484,6 +556,12 @@ void MxPropSlim::constrain_boundaries()
 
 void MxPropSlim::compute_edge_info(edge_info *info)
 {
+    if( vertex_is_locked(info->v1) && vertex_is_locked(info->v2) )
+    {
+        heap.remove(info);
+        return;
+    }
+
     compute_target_placement(info);
 
 //     if( will_normalize_error )
@@ -504,18 +582,40 @@ void MxPropSlim::finalize_edge_update(edge_info *info)
 //         apply_mesh_penalties(info);
 
     if( info->is_in_heap() )
+    {
         heap.update(info);
+        recomputations++;
+    }
     else
         heap.insert(info);
 }
 
+void MxPropSlim::link_edge(MxVertexID v, edge_info *e)
+{
+    link_slot(e, v) = edge_links(v).length();
+    edge_links(v).add(e);
+}
+
+void MxPropSlim::unlink_edge(MxVertexID v, edge_info *e)
+{
+    // remove() moves the last link into the hole, so follow it
+    uint j = link_slot(e, v);
+    SanityCheck( edge_links(v)(j)==e );
+    edge_links(v).remove(j);
+    if( j<(uint)edge_links(v).length() )
+        link_slot(edge_links(v)(j), v) = j;
+}
+
 void MxPropSlim::update_pre_contract(const MxPairContraction& conx)
 {
     MxVertexID v1=conx.v1, v2=conx.v2;
-    uint i, j;
+    uint i;
 
-    star.reset();
-    m->collect_vertex_star(v1, star);
+    star_list.reset();
+    m->collect_vertex_star(v1, star_list);
+    star.next();
+    for(i=0; i<star_list.length(); i++)
+        star.mark(star_list(i));
 
     for(i=0; i<edge_links(v2).length(); i++)
     {
@@ -524,21 +624,20 @@ void MxPropSlim::update_pre_contract(const MxPairContraction& conx)
         SanityCheck( e->v1==v2 || e->v2==v2 );
         SanityCheck( u!=v2 );
 
-        if( u==v1 || varray_find(star, u) )
+        if( u==v1 || star.is_marked(u) )
         {
             // This is a useless link --- kill it
-            bool found = varray_find(edge_links(u), e, &j);
-            assert( found );
-            edge_links(u).remove(j);
+            unlink_edge(u, e);
             heap.remove(e);
             if( u!=v1 ) delete e; // (v1,v2) will be deleted later
         }
         else
         {
-            // Relink this to v1
+            // Relink this to v1, u keeps its slot
+            e->slot2 = link_slot(e, u);
             e->v1 = v1;
             e->v2 = u;
-            edge_links(v1).add(e);
+            link_edge(v1, e);
         }
     }
 
@@ -31,6 +31,7 @@ private:
     {
     public:
 	MxVertexID v1, v2;
+	uint slot1, slot2;	// place in edge_links(v1) and edge_links(v2)
 	MxVector target;
 
 	edge_info(uint D) : target(D) { }
@@ -43,9 +44,15 @@ private:
 
     //
     // Temporary variables used by methods
-    MxVertexList star, star2;
+    MxVertexList star_list;
+    MxVertexStamps star;
     MxPairContraction conx_tmp;
 
+    uint& link_slot(edge_info *e, MxVertexID v)
+	{ return (e->v1==v)?e->slot1:e->slot2; }
+    void link_edge(MxVertexID v, edge_info *e);
+    void unlink_edge(MxVertexID v, edge_info *e);
+
 protected:
     uint compute_dimension(MxStdModel *);
     void pack_to_vector(MxVertexID, MxVector&);
@@ -73,6 +80,7 @@ public:
 
 public:
     MxPropSlim(MxStdModel&);
+    virtual ~MxPropSlim();
 
     uint dim() const { return D; }
 
@@ -87,6 +95,7 @@ public:
 
     void initialize();
     bool decimate(uint);
+    size_t memory_usage();
 
 };
 
@@ -12,6 +12,8 @@
 #include "MxQSlim.h"
 #include "MxGeom3D.h"
 #include "MxVector.h"
+#include "../gsalt_timer.h"
+#include "../gsalt_trace.h"
 
 typedef MxQuadric3 Quadric;
 
@@ -25,17 +27,31 @@ MxQSlim::MxQSlim(MxStdModel& _m)
 
 void MxQSlim::initialize()
 {
+    double t0 = gsalt_time();
     collect_quadrics();
+    double t1 = gsalt_time();
     if( boundary_weight > 0.0 )
 	constrain_boundaries();
     if( object_transform )
 	transform_quadrics(*object_transform);
+    double t2 = gsalt_time();
+    time_quadrics = t1 - t0;
+    time_boundaries = t2 - t1;
+    gsalt_trace_complete("collect_quadrics", t0, t1);
+    gsalt_trace_complete("constrain_boundaries", t1, t2);
 
     is_initialized = true;
 }
 
-void MxQSlim::collect_quadrics()
+size_t MxQSlim::memory_usage()
+{
+    return MxStdSlim::memory_usage() + quadrics.length()*sizeof(Quadric);
+}
+
+template<int weighting>
+void MxQSlim::collect_quadrics_t()
 {
+    const int weight = (weighting==MX_POLICY_RUNTIME)?weighting_policy:weighting;
     uint j;
 
     for(j=0; j<quadrics.length(); j++)
@@ -49,12 +65,12 @@ void MxQSlim::collect_quadrics()
 	Vec3 v2(m->vertex(f(1)));
 	Vec3 v3(m->vertex(f(2)));
 
-	Vec4 p = (weighting_policy==MX_WEIGHT_RAWNORMALS) ?
+	Vec4 p = (weight==MX_WEIGHT_RAWNORMALS) ?
 		    triangle_raw_plane<Vec3,Vec4>(v1, v2, v3):
 		    triangle_plane<Vec3,Vec4>(v1, v2, v3);
 	Quadric Q(p[X], p[Y], p[Z], p[W], m->compute_face_area(i));
 
-	switch( weighting_policy )
+	switch( weight )
 	{
 	case MX_WEIGHT_ANGLE:
 	    for(j=0; j<3; j++)
@@ -77,6 +93,14 @@ void MxQSlim::collect_quadrics()
     }
 }
 
+void MxQSlim::collect_quadrics()
+{
+    if( weighting_policy==MX_WEIGHT_AREA )
+	collect_quadrics_t<MX_WEIGHT_AREA>();
+    else
+	collect_quadrics_t<MX_POLICY_RUNTIME>();
+}
+
 void MxQSlim::transform_quadrics(const Mat4& P)
 {
     for(uint j=0; j<quadrics.length(); j++)
@@ -133,18 +157,95 @@ void MxQSlim::constrain_boundaries()
     }
 }
 
+//
+// Cost and position of contracting j into i, shared by the edge engines
+//
+template<int placement, int weighting>
+inline real MxQSlim::pair_target_t(MxVertexID i, MxVertexID j, float *vnew)
+{
+    const int place = (placement==MX_POLICY_RUNTIME)?placement_policy:placement;
+    const int weight = (weighting==MX_POLICY_RUNTIME)?weighting_policy:weighting;
+    const Quadric &Qi=quadrics(i), &Qj=quadrics(j);
+
+    Quadric Q = Qi;  Q += Qj;
+    real e_min;
+
+    if( vertex_is_locked(i) )
+    {
+	Vec3 vi(m->vertex(i));
+	e_min = Q(vi);
+	vnew[X] = vi[X];
+	vnew[Y] = vi[Y];
+	vnew[Z] = vi[Z];
+    }
+    else if( place==MX_PLACE_OPTIMAL &&
+	Q.optimize(&vnew[X], &vnew[Y], &vnew[Z]) )
+    {
+	e_min = Q(vnew);
+    }
+    else
+    {
+	if( place==MX_PLACE_OPTIMAL ) optimize_fallbacks++;
+
+	Vec3 vi(m->vertex(i)), vj(m->vertex(j));	
+	Vec3 best;
+
+	if( place>=MX_PLACE_LINE && Q.optimize(best, vi, vj) )
+	    e_min = Q(best);
+	else
+	{
+	    real ei=Q(vi), ej=Q(vj);
+
+	    if( ei < ej ) { e_min = ei; best = vi; }
+	    else          { e_min = ej; best = vj; }
+
+	    if( place>=MX_PLACE_ENDORMID )
+	    {
+		Vec3 mid = (vi+vj)/2.0;
+		real e_mid = Q(mid);
+
+		if( e_mid < e_min ) { e_min = e_mid; best = mid; }
+	    }
+	}
+
+	vnew[X] = best[X];
+	vnew[Y] = best[Y];
+	vnew[Z] = best[Z];
+    }
+
+    if( weight == MX_WEIGHT_AREA_AVG )
+ 	e_min /= Q.area();
+
+    return e_min;
+}
+
+real MxQSlim::pair_target(MxVertexID i, MxVertexID j, float *vnew)
+{
+    return pair_target_t<MX_POLICY_RUNTIME, MX_POLICY_RUNTIME>(i, j, vnew);
+}
+
 
 
 
 MxEdgeQSlim::MxEdgeQSlim(MxStdModel& _m)
   : MxQSlim(_m),
-    edge_links(_m.vert_count())
+    edge_links(_m.vert_count()),
+    star(_m.vert_count())
 {
     contraction_callback = NULL;
 }
 
 MxEdgeQSlim::~MxEdgeQSlim()
 {
+    // Edges out of the heap (between two locked vertices) are only in the links
+    for(uint i=0; i<edge_links.length(); i++)
+	for(uint j=0; j<edge_links(i).length(); j++)
+	{
+	    MxQSlimEdge *e = edge_links(i)(j);
+	    // each is in the links of both ends, freed at the last one
+	    if( !e->is_in_heap() && i==MAX(e->v1, e->v2) )  delete e;
+	}
+
     // Delete everything remaining in the heap
     for(uint i=0; i<heap.size(); i++)
 	delete ((MxQSlimEdge *)heap.item(i));
@@ -204,6 +305,25 @@ real MxEdgeQSlim::check_local_inversion(uint v1,uint/*v2*/,const float *vnew)
     return Nmin;
 }
 
+//
+// Does moving v to vnew take it (nearly) across the side x-y of its face?
+//
+static bool moves_across(const float *v, const float *x, const float *y,
+			 const float *vnew, real threshold)
+{
+    float d_yx[3], d_vx[3], d_vnew[3], f_n[3], n[3];
+    mxv_sub(d_yx, y, x, 3);          // d_yx = y-x
+    mxv_sub(d_vx, v, x, 3);          // d_vx = v-x
+    mxv_sub(d_vnew, vnew, x, 3);     // d_vnew = vnew-x
+
+    mxv_cross3(f_n, d_yx, d_vx);
+    mxv_cross3(n, f_n, d_yx);     // n = ((y-x)^(v-x))^(y-x)
+    mxv_unitize(n, 3);
+
+    // assert( mxv_dot(d_vx, n, 3) > -FEQ_EPS );
+    return mxv_dot(d_vnew,n,3) < threshold*mxv_dot(d_vx,n,3);
+}
+
 uint MxEdgeQSlim::check_local_validity(uint v1, uint /*v2*/, const float *vnew)
 
 {
@@ -219,17 +339,8 @@ uint MxEdgeQSlim::check_local_validity(uint v1, uint /*v2*/, const float *vnew)
 	    uint x = f[(k+1)%3];
 	    uint y = f[(k+2)%3];
 
-	    float d_yx[3], d_vx[3], d_vnew[3], f_n[3], n[3];
-	    mxv_sub(d_yx, m->vertex(y),  m->vertex(x), 3);   // d_yx = y-x
-	    mxv_sub(d_vx, m->vertex(v1), m->vertex(x), 3);   // d_vx = v-x
-	    mxv_sub(d_vnew, vnew, m->vertex(x), 3);          // d_vnew = vnew-x
-
-	    mxv_cross3(f_n, d_yx, d_vx);
-	    mxv_cross3(n, f_n, d_yx);     // n = ((y-x)^(v-x))^(y-x)
-	    mxv_unitize(n, 3);
-
-	    // assert( mxv_dot(d_vx, n, 3) > -FEQ_EPS );
-	    if(mxv_dot(d_vnew,n,3)<local_validity_threshold*mxv_dot(d_vx,n,3))
+	    if( moves_across(m->vertex(v1), m->vertex(x), m->vertex(y), vnew,
+			     local_validity_threshold) )
 		nfailed++;
 	}
 
@@ -329,83 +440,68 @@ void MxEdgeQSlim::apply_mesh_penalties(MxQSlimEdge *info)
     info->heap_key(base_error - bias);
 }
 
-void MxEdgeQSlim::compute_target_placement(MxQSlimEdge *info)
+template<int placement, int weighting>
+inline void MxEdgeQSlim::compute_target_placement(MxQSlimEdge *info)
 {
-    MxVertexID i=info->v1, j=info->v2;
-
-    const Quadric &Qi=quadrics(i), &Qj=quadrics(j);
-
-    Quadric Q = Qi;  Q += Qj;
-    real e_min;
-
-    if( placement_policy==MX_PLACE_OPTIMAL &&
-	Q.optimize(&info->vnew[X], &info->vnew[Y], &info->vnew[Z]) )
-    {
-	e_min = Q(info->vnew);
-    }
-    else
+    // A locked vertex is always the one kept, and stays where it is
+    if( vertex_is_locked(info->v2) )
     {
-	Vec3 vi(m->vertex(i)), vj(m->vertex(j));	
-	Vec3 best;
-
-	if( placement_policy>=MX_PLACE_LINE && Q.optimize(best, vi, vj) )
-	    e_min = Q(best);
-	else
-	{
-	    real ei=Q(vi), ej=Q(vj);
-
-	    if( ei < ej ) { e_min = ei; best = vi; }
-	    else          { e_min = ej; best = vj; }
-
-	    if( placement_policy>=MX_PLACE_ENDORMID )
-	    {
-		Vec3 mid = (vi+vj)/2.0;
-		real e_mid = Q(mid);
-
-		if( e_mid < e_min ) { e_min = e_mid; best = mid; }
-	    }
-	}
-
-	info->vnew[X] = best[X];
-	info->vnew[Y] = best[Y];
-	info->vnew[Z] = best[Z];
+	MxVertexID t = info->v1;  info->v1 = info->v2;  info->v2 = t;
+	uint s = info->slot1;  info->slot1 = info->slot2;  info->slot2 = s;
     }
 
-    if( weighting_policy == MX_WEIGHT_AREA_AVG )
- 	e_min /= Q.area();
-
-    info->heap_key(-e_min);
+    info->heap_key(-pair_target_t<placement, weighting>(info->v1, info->v2,
+							 info->vnew));
 }
 
-void MxEdgeQSlim::finalize_edge_update(MxQSlimEdge *info)
+template<int penalties>
+inline void MxEdgeQSlim::finalize_edge_update(MxQSlimEdge *info)
 {
-    if( meshing_penalty > 1.0 )
+    if( penalties==MX_POLICY_RUNTIME ? meshing_penalty > 1.0 : penalties!=0 )
 	apply_mesh_penalties(info);
 
     if( info->is_in_heap() )
+    {
 	heap.update(info);
+	recomputations++;
+    }
     else
 	heap.insert(info);
 }
 
+template<int placement, int weighting, int penalties>
+inline void MxEdgeQSlim::compute_edge_info_t(MxQSlimEdge *info)
+{
+    // Relinked between two locked vertex by a contraction: never a candidate again
+    if( vertex_is_locked(info->v1) && vertex_is_locked(info->v2) )
+    {
+	heap.remove(info);
+	return;
+    }
+
+    compute_target_placement<placement, weighting>(info);
+
+    finalize_edge_update<penalties>(info);
+}
 
 void MxEdgeQSlim::compute_edge_info(MxQSlimEdge *info)
 {
-    compute_target_placement(info);
-
-    finalize_edge_update(info);
+    compute_edge_info_t<MX_POLICY_RUNTIME, MX_POLICY_RUNTIME,
+			MX_POLICY_RUNTIME>(info);
 }
 
 void MxEdgeQSlim::create_edge(MxVertexID i, MxVertexID j)
 {
-    MxQSlimEdge *info = new MxQSlimEdge;
+    if( vertex_is_locked(i) && vertex_is_locked(j) )  return;
 
-    edge_links(i).add(info);
-    edge_links(j).add(info);
+    MxQSlimEdge *info = new MxQSlimEdge;
 
     info->v1 = i;
     info->v2 = j;
 
+    link_edge(i, info);
+    link_edge(j, info);
+
     compute_edge_info(info);
 }
 
@@ -413,36 +509,88 @@ void MxEdgeQSlim::collect_edges()
 {
     MxVertexList star;
 
+    // The stars of locked vertices are never walked: their edges to
+    // unlocked neighbours are added from the other end.
     for(MxVertexID i=0; i<m->vert_count(); i++)
     {
+	if( vertex_is_locked(i) )  continue;
+
 	star.reset();
 	m->collect_vertex_star(i, star);
 
 	for(uint j=0; j<star.length(); j++)
-	    if( i < star(j) )  // Only add particular edge once
-		create_edge(i, star(j));
+	    if( i < star(j) || vertex_is_locked(star(j)) )
+		create_edge(i, star(j));  // Only add particular edge once
     }
 }
 
 void MxEdgeQSlim::initialize()
 {
     MxQSlim::initialize();
+    double t = gsalt_time();
     collect_edges();
+    time_edges = gsalt_time() - t;
+    gsalt_trace_complete("collect_edges", t, t + time_edges);
 }
 
 void MxEdgeQSlim::initialize(const MxEdge *edges, uint count)
 {
     MxQSlim::initialize();
+    double t = gsalt_time();
     for(uint i=0; i<count; i++)
 	create_edge(edges[i].v1, edges[i].v2);
+    time_edges = gsalt_time() - t;
+    gsalt_trace_complete("collect_edges", t, t + time_edges);
+}
+
+size_t MxEdgeQSlim::memory_usage()
+{
+    // every live edge is in the heap
+    size_t bytes = MxQSlim::memory_usage()
+	+ edge_links.length()*sizeof(edge_list)
+	+ heap.size()*sizeof(MxQSlimEdge)
+	+ star.memory_usage();
+
+    for(uint i=0; i<edge_links.length(); i++)
+	bytes += edge_links(i).total_space()*sizeof(MxQSlimEdge *);
+
+    return bytes;
+}
+
+void MxEdgeQSlim::link_edge(MxVertexID v, MxQSlimEdge *e)
+{
+    link_slot(e, v) = edge_links(v).length();
+    edge_links(v).add(e);
+}
+
+void MxEdgeQSlim::unlink_edge(MxVertexID v, MxQSlimEdge *e)
+{
+    // remove() moves the last link into the hole, so follow it
+    uint j = link_slot(e, v);
+    SanityCheck( edge_links(v)(j)==e );
+    edge_links(v).remove(j);
+    if( j<(uint)edge_links(v).length() )
+	link_slot(edge_links(v)(j), v) = j;
+}
+
+void MxEdgeQSlim::relink_edge(MxQSlimEdge *e, MxVertexID from, MxVertexID to)
+{
+    // e must already be out of edge_links(from)
+    MxVertexID u = e->opposite_vertex(from);
+    uint slot = link_slot(e, u);
+
+    e->v1 = to;
+    e->v2 = u;
+    e->slot2 = slot;
+    link_edge(to, e);
 }
 
 void MxEdgeQSlim::update_pre_contract(const MxPairContraction& conx)
 {
     MxVertexID v1=conx.v1, v2=conx.v2;
-    uint i, j;
+    uint i;
 
-    star.reset();
+    star.next();
     //
     // Before, I was gathering the vertex "star" using:
     //      m->collect_vertex_star(v1, star);
@@ -451,7 +599,7 @@ void MxEdgeQSlim::update_pre_contract(const MxPairContraction& conx)
     // from the edge links maintained at v1.
     //
     for(i=0; i<edge_links(v1).length(); i++)
-	star.add(edge_links(v1)[i]->opposite_vertex(v1));
+	star.mark(edge_links(v1)[i]->opposite_vertex(v1));
 
     for(i=0; i<edge_links(v2).length(); i++)
     {
@@ -460,22 +608,16 @@ void MxEdgeQSlim::update_pre_contract(const MxPairContraction& conx)
 	SanityCheck( e->v1==v2 || e->v2==v2 );
 	SanityCheck( u!=v2 );
 
-	if( u==v1 || varray_find(star, u) )
+	if( u==v1 || star.is_marked(u) )
 	{
 	    // This is a useless link --- kill it
-	    bool found = varray_find(edge_links(u), e, &j);
-	    assert( found );
-	    edge_links(u).remove(j);
+	    unlink_edge(u, e);
 	    heap.remove(e);
 	    if( u!=v1 ) delete e; // (v1,v2) will be deleted later
 	}
 	else
-	{
 	    // Relink this to v1
-	    e->v1 = v1;
-	    e->v2 = u;
-	    edge_links(v1).add(e);
-	}
+	    relink_edge(e, v2, v1);
     }
 
     edge_links(v2).reset();
@@ -485,7 +627,8 @@ void MxEdgeQSlim::update_post_contract(const MxPairContraction& conx)
 {
 }
 
-void MxEdgeQSlim::apply_contraction(const MxPairContraction& conx)
+template<int placement, int weighting, int penalties>
+void MxEdgeQSlim::apply_contraction_t(const MxPairContraction& conx)
 {
     //
     // Pre-contraction update
@@ -502,7 +645,14 @@ void MxEdgeQSlim::apply_contraction(const MxPairContraction& conx)
     // Must update edge info here so that the meshing penalties
     // will be computed with respect to the new mesh rather than the old
     for(uint i=0; i<edge_links(conx.v1).length(); i++)
-	compute_edge_info(edge_links(conx.v1)[i]);
+	compute_edge_info_t<placement, weighting, penalties>
+	    (edge_links(conx.v1)[i]);
+}
+
+void MxEdgeQSlim::apply_contraction(const MxPairContraction& conx)
+{
+    apply_contraction_t<MX_POLICY_RUNTIME, MX_POLICY_RUNTIME,
+			MX_POLICY_RUNTIME>(conx);
 }
 
 void MxEdgeQSlim::update_pre_expand(const MxPairContraction&)
@@ -514,10 +664,14 @@ void MxEdgeQSlim::update_post_expand(const MxPairContraction& conx)
     MxVertexID v1=conx.v1, v2=conx.v2;
     uint i;
 
-    star.reset(); star2.reset();
+    star.next();
     PRECAUTION(edge_links(conx.v2).reset());
-    m->collect_vertex_star(conx.v1, star);
-    m->collect_vertex_star(conx.v2, star2);
+    star_list.reset();
+    m->collect_vertex_star(conx.v1, star_list);
+    for(i=0; i<star_list.length(); i++)  star.mark(star_list(i), 0);
+    star_list.reset();
+    m->collect_vertex_star(conx.v2, star_list);
+    for(i=0; i<star_list.length(); i++)  star.mark(star_list(i), 1);
 
     i = 0;
     while( i<edge_links(v1).length() )
@@ -527,8 +681,8 @@ void MxEdgeQSlim::update_post_expand(const MxPairContraction& conx)
 	SanityCheck( e->v1==v1 || e->v2==v1 );
 	SanityCheck( u!=v1 && u!=v2 );
 
-	bool v1_linked = varray_find(star, u);
-	bool v2_linked = varray_find(star2, u);
+	bool v1_linked = star.is_marked(u, 0);
+	bool v2_linked = star.is_marked(u, 1);
 
 	if( v1_linked )
 	{
@@ -541,16 +695,14 @@ void MxEdgeQSlim::update_post_expand(const MxPairContraction& conx)
 	    //         Need to find out why, and whether it's my
 	    //         expectation or the code that's wrong.
 	    // SanityCheck(v2_linked);
-	    e->v1 = v2;
-	    e->v2 = u;
-	    edge_links(v2).add(e);
-	    edge_links(v1).remove(i);
+	    unlink_edge(v1, e);
+	    relink_edge(e, v1, v2);
 	}
 
 	compute_edge_info(e);
     }
 
-    if( varray_find(star, v2) )
+    if( star.is_marked(v2, 0) )
 	// ?? BUG: Is it legitimate for there not to be an edge here ??
 	create_edge(v1, v2);
 }
@@ -571,14 +723,16 @@ void MxEdgeQSlim::apply_expansion(const MxPairContraction& conx)
     update_post_expand(conx);
 }
 
-bool MxEdgeQSlim::decimate(uint target)
+template<int placement, int weighting, int penalties>
+bool MxEdgeQSlim::decimate_t(uint target)
 {
     MxPairContraction local_conx;
 
-    while( valid_faces > target )
+    while( valid_faces > target && !stopped && !error_limit_reached() )
     {
 	MxQSlimEdge *info = (MxQSlimEdge *)heap.extract();
 	if( !info ) { return false; }
+	heap_extracts++;
 
 	MxVertexID v1=info->v1, v2=info->v2;
 
@@ -588,13 +742,21 @@ bool MxEdgeQSlim::decimate(uint target)
 
 	    m->compute_contraction(v1, v2, &conx, info->vnew);
 
-	    if( will_join_only && conx.dead_faces.length()>0 ) continue;
+	    if( will_join_only && conx.dead_faces.length()>0 )
+	    {
+		rejected_extracts++;
+		continue;
+	    }
 
 	    if( contraction_callback )
 		(*contraction_callback)(conx, -info->heap_key());
 	    
-	    apply_contraction(conx);
+	    apply_contraction_t<placement, weighting, penalties>(conx);
+
+	    record_contraction(-info->heap_key());
 	}
+	else
+	    stale_extracts++;
 
 	delete info;
     }
@@ -602,6 +764,248 @@ bool MxEdgeQSlim::decimate(uint target)
     return true;
 }
 
+bool MxEdgeQSlim::decimate(uint target)
+{
+    // The policies do not change during a run: choose the loop once
+    if( default_policies() )
+	return decimate_t<MX_PLACE_OPTIMAL, MX_WEIGHT_AREA, 0>(target);
+
+    return decimate_t<MX_POLICY_RUNTIME, MX_POLICY_RUNTIME,
+		      MX_POLICY_RUNTIME>(target);
+}
+
+
+
+MxHalfEdgeQSlim::MxHalfEdgeQSlim(MxStdModel& _m)
+  : MxQSlim(_m),
+    he(_m.vert_count(), _m.face_count()),
+    edge_of(3*_m.face_count())
+{
+    manifold = false;
+    for(uint h=0; h<edge_of.length(); h++)  edge_of(h) = NULL;
+}
+
+MxHalfEdgeQSlim::~MxHalfEdgeQSlim()
+{
+    // Each record is referenced by its own half-edge, and maybe the twin
+    for(MxHalfEdgeID h=0; h<edge_of.length(); h++)
+	if( edge_of(h) && edge_of(h)->h==h )
+	{
+	    MxHalfEdgeID g = he.twin(h);
+	    if( g!=MXID_NIL )  edge_of(g) = NULL;
+	    delete edge_of(h);
+	}
+}
+
+size_t MxHalfEdgeQSlim::memory_usage()
+{
+    return MxQSlim::memory_usage()
+	+ he.memory_usage()
+	+ edge_of.length()*sizeof(edge_info *)
+	+ heap.size()*sizeof(edge_info);
+}
+
+uint MxHalfEdgeQSlim::check_local_validity(MxVertexID v, MxVertexID other,
+					   const float *vnew)
+{
+    MxHalfEdgeID h0 = he.out(v), h = h0;
+    uint nfailed = 0;
+
+    if( h0==MXID_NIL )  return 0;
+    do
+    {
+	// Only the faces that survive the contraction
+	MxVertexID x = he.target(h), y = he.origin(he.prev(h));
+	if( x!=other && y!=other &&
+	    moves_across(m->vertex(v), m->vertex(x), m->vertex(y), vnew,
+			 local_validity_threshold) )
+	    nfailed++;
+	h = he.next_out(h);
+    } while( h!=MXID_NIL && h!=h0 );
+
+    return nfailed;
+}
+
+void MxHalfEdgeQSlim::apply_mesh_penalties(edge_info *info)
+{
+    real bias = 0.0;
+
+    uint max_degree = MAX(he.face_degree(info->v1), he.face_degree(info->v2));
+    if( max_degree > vertex_degree_limit )
+	bias += (max_degree-vertex_degree_limit) * meshing_penalty * 0.001;
+
+    uint nfailed = check_local_validity(info->v1, info->v2, info->vnew);
+    nfailed += check_local_validity(info->v2, info->v1, info->vnew);
+    if( nfailed )
+	bias += nfailed*meshing_penalty;
+
+    info->heap_key(info->heap_key() - bias);
+}
+
+template<int placement, int weighting, int penalties>
+inline void MxHalfEdgeQSlim::compute_edge_info_t(edge_info *info)
+{
+    MxVertexID a = he.origin(info->h), b = he.target(info->h);
+
+    if( he.vertex_is_frozen(a) || he.vertex_is_frozen(b) ||
+	(vertex_is_locked(a) && vertex_is_locked(b)) )
+    {
+	heap.remove(info);
+	return;
+    }
+
+    // A locked vertex is always the one kept, otherwise the one with
+    // more faces, as the collapse walks the fan of the other
+    if( vertex_is_locked(b) ||
+	(!vertex_is_locked(a) && he.face_degree(b) > he.face_degree(a)) )
+	{ info->v1 = b;  info->v2 = a; }
+    else
+	{ info->v1 = a;  info->v2 = b; }
+
+    info->heap_key(-pair_target_t<placement, weighting>(info->v1, info->v2,
+							 info->vnew));
+
+    if( penalties==MX_POLICY_RUNTIME ? meshing_penalty > 1.0 : penalties!=0 )
+	apply_mesh_penalties(info);
+
+    if( info->is_in_heap() )
+    {
+	heap.update(info);
+	recomputations++;
+    }
+    else
+	heap.insert(info);
+}
+
+void MxHalfEdgeQSlim::compute_edge_info(edge_info *info)
+{
+    compute_edge_info_t<MX_POLICY_RUNTIME, MX_POLICY_RUNTIME,
+			MX_POLICY_RUNTIME>(info);
+}
+
+void MxHalfEdgeQSlim::initialize()
+{
+    MxQSlim::initialize();
+    double t = gsalt_time();
+
+    manifold = he.build(*m);
+    if( manifold )
+	for(MxHalfEdgeID h=0; h<edge_of.length(); h++)
+	{
+	    MxHalfEdgeID g = he.twin(h);
+	    if( !he.face_is_valid(he.face(h)) || (g!=MXID_NIL && g<h) )
+		continue;
+
+	    MxVertexID a = he.origin(h), b = he.target(h);
+	    if( he.vertex_is_frozen(a) || he.vertex_is_frozen(b) ||
+		(vertex_is_locked(a) && vertex_is_locked(b)) )
+		continue;
+
+	    edge_info *info = new edge_info;
+	    info->h = h;
+	    edge_of(h) = info;
+	    if( g!=MXID_NIL )  edge_of(g) = info;
+	    compute_edge_info(info);
+	}
+
+    time_edges = gsalt_time() - t;
+    gsalt_trace_complete("collect_edges", t, t + time_edges);
+}
+
+template<int placement, int weighting, int penalties>
+void MxHalfEdgeQSlim::contract_t(edge_info *info)
+{
+    MxVertexID v1=info->v1, v2=info->v2;
+    MxHalfEdgeID h = info->h, t = he.twin(h);
+    MxHalfEdgeCollapse conx;
+    uint i;
+
+    he.collapse(h, v1, conx);
+    edge_of(h) = NULL;
+    if( t!=MXID_NIL )  edge_of(t) = NULL;
+
+    //
+    // The two other sides of each dead face are now one edge
+    for(i=0; i<conx.dead_count; i++)
+    {
+	MxHalfEdgeID p = conx.glued[i][0], q = conx.glued[i][1];
+	edge_info *ep = edge_of(conx.gone[i][0]);
+	edge_info *eq = edge_of(conx.gone[i][1]);
+	edge_of(conx.gone[i][0]) = edge_of(conx.gone[i][1]) = NULL;
+
+	edge_info *e = ep?ep:eq;
+	if( ep && eq )  { heap.remove(eq);  delete eq; }
+	if( e && p==MXID_NIL && q==MXID_NIL )
+	{
+	    heap.remove(e);  delete e;  e = NULL;
+	}
+	if( e )  e->h = (p!=MXID_NIL)?p:q;
+	if( p!=MXID_NIL )  edge_of(p) = e;
+	if( q!=MXID_NIL )  edge_of(q) = e;
+
+	m->face_mark_invalid(conx.dead[i]);
+	valid_faces--;
+    }
+
+    quadrics(v1) += quadrics(v2);
+    m->vertex(v1)[X] = info->vnew[X];
+    m->vertex(v1)[Y] = info->vnew[Y];
+    m->vertex(v1)[Z] = info->vnew[Z];
+    m->vertex_mark_invalid(v2);
+    valid_verts--;
+    delete info;
+
+    //
+    // The faces of v2 now use v1, and every edge of v1 has a new cost
+    ring_edges.reset();
+    he.collect_edges(v1, ring_edges);
+    for(i=0; i<(uint)ring_edges.length(); i++)
+    {
+	MxHalfEdgeID e = ring_edges(i);
+	if( he.origin(e)==v1 )
+	    m->face(he.face(e)).remap_vertex(v2, v1);
+	if( edge_of(e) )
+	    compute_edge_info_t<placement, weighting, penalties>(edge_of(e));
+    }
+}
+
+template<int placement, int weighting, int penalties>
+bool MxHalfEdgeQSlim::decimate_t(uint target)
+{
+    while( valid_faces > target && !stopped && !error_limit_reached() )
+    {
+	edge_info *info = (edge_info *)heap.extract();
+	if( !info ) { return false; }
+	heap_extracts++;
+
+	// Back in the heap when a contraction nearby changes its cost
+	if( !he.check_link(info->h) )
+	{
+	    rejected_extracts++;
+	    continue;
+	}
+
+	real err = -info->heap_key();
+	contract_t<placement, weighting, penalties>(info);
+	record_contraction(err);
+    }
+
+    return true;
+}
+
+bool MxHalfEdgeQSlim::decimate(uint target)
+{
+    if( !manifold )  return false;
+
+    if( default_policies() )
+	return decimate_t<MX_PLACE_OPTIMAL, MX_WEIGHT_AREA, 0>(target);
+
+    return decimate_t<MX_POLICY_RUNTIME, MX_POLICY_RUNTIME,
+		      MX_POLICY_RUNTIME>(target);
+}
+
+
+
 
 
 void MxFaceQSlim::compute_face_info(MxFaceID f)
@@ -613,6 +1017,12 @@ void MxFaceQSlim::compute_face_info(MxFaceID f)
     MxVertexID j = m->face(f)(1);
     MxVertexID k = m->face(f)(2);
 
+    if( vertex_is_locked(i) || vertex_is_locked(j) || vertex_is_locked(k) )
+    {
+	if( info.is_in_heap() )  heap.remove(&info);
+	return;
+    }
+
     const Quadric& Qi = quadrics(i);
     const Quadric& Qj = quadrics(j);
     const Quadric& Qk = quadrics(k);
@@ -628,6 +1038,8 @@ void MxFaceQSlim::compute_face_info(MxFaceID f)
     }
     else
     {
+      if( placement_policy == MX_PLACE_OPTIMAL ) optimize_fallbacks++;
+
       Vec3 v1(m->vertex(i)), v2(m->vertex(j)), v3(m->vertex(k));
       real e1=Q(v1), e2=Q(v2), e3=Q(v3);
 
@@ -648,7 +1060,10 @@ void MxFaceQSlim::compute_face_info(MxFaceID f)
 	info.heap_key(info.heap_key() / Q.area());
 
     if( info.is_in_heap() )
+    {
 	heap.update(&info);
+	recomputations++;
+    }
     else
 	heap.insert(&info);
 }
@@ -663,8 +1078,16 @@ void MxFaceQSlim::initialize()
 {
     MxQSlim::initialize();
 
+    double t = gsalt_time();
     for(MxFaceID f=0; f<m->face_count(); f++)
       compute_face_info(f);
+    time_edges = gsalt_time() - t;
+    gsalt_trace_complete("collect_faces", t, t + time_edges);
+}
+
+size_t MxFaceQSlim::memory_usage()
+{
+    return MxQSlim::memory_usage() + f_info.length()*sizeof(tri_info);
 }
 
 bool MxFaceQSlim::decimate(uint target)
@@ -673,10 +1096,11 @@ bool MxFaceQSlim::decimate(uint target)
 
     MxFaceList changed;
 
-    while( valid_faces > target )
+    while( valid_faces > target && !stopped && !error_limit_reached() )
     {
 	tri_info *info = (tri_info *)heap.extract();
 	if( !info ) { return false; }
+	heap_extracts++;
 
 	MxFaceID f = info->f;
 	MxVertexID v1 = m->face(f)(0),
@@ -698,12 +1122,16 @@ bool MxFaceQSlim::decimate(uint target)
 	    for(i=0; i<changed.length(); i++)
 		if( !m->face_is_valid(changed(i)) ) valid_faces--;
 
+	    record_contraction(-info->heap_key());
+
 	    for(i=0; i<changed.length(); i++)
 		if( m->face_is_valid(changed(i)) )
 		    compute_face_info(changed(i));
 		else
 		    heap.remove(&f_info(changed(i)));
 	}
+	else
+	    stale_extracts++;
     }
 
     return true;
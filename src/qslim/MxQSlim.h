@@ -16,6 +16,7 @@
 #include "stdmix.h"
 #include "MxStdSlim.h"
 #include "MxQMetric3.h"
+#include "MxHalfEdge.h"
 
 class MxQSlim : public MxStdSlim
 {
@@ -23,10 +24,21 @@ protected:
     MxBlock<MxQuadric3> quadrics;
 
     void discontinuity_constraint(MxVertexID, MxVertexID, const MxFaceList&);
+    template<int weighting> void collect_quadrics_t();
     void collect_quadrics();
     void transform_quadrics(const Mat4&);
     void constrain_boundaries();
 
+    //
+    // The edge engines run their decimation loop instantiated for the
+    // default policies, and fall back on MX_POLICY_RUNTIME otherwise.
+    bool default_policies() const
+	{ return placement_policy==MX_PLACE_OPTIMAL &&
+		 weighting_policy==MX_WEIGHT_AREA && meshing_penalty<=1.0; }
+    template<int placement, int weighting>
+    real pair_target_t(MxVertexID i, MxVertexID j, float *vnew);
+    real pair_target(MxVertexID i, MxVertexID j, float *vnew);
+
 public:
 
     Mat4 *object_transform;
@@ -36,14 +48,19 @@ public:
     virtual ~MxQSlim() { }
 
     virtual void initialize();
+    virtual size_t memory_usage();
 
     const MxQuadric3& vertex_quadric(MxVertexID v) { return quadrics(v); }
+    bool area_weighted() const
+	{ return weighting_policy==MX_WEIGHT_AREA ||
+		 weighting_policy==MX_WEIGHT_AREA_AVG; }
 };
 
 class MxQSlimEdge : public MxEdge, public MxHeapable
 {
 public:
     float vnew[3];
+    uint slot1, slot2;        // place in edge_links(v1) and edge_links(v2)
 };
 
 class MxEdgeQSlim : public MxQSlim
@@ -55,9 +72,16 @@ private:
 
     //
     // Temporary variables used by methods
-    MxVertexList star, star2;
+    MxVertexList star_list;
+    MxVertexStamps star;      // set 0: star of v1, set 1: star of v2
     MxPairContraction conx_tmp;
 
+    uint& link_slot(MxQSlimEdge *e, MxVertexID v)
+	{ return (e->v1==v)?e->slot1:e->slot2; }
+    void link_edge(MxVertexID v, MxQSlimEdge *e);
+    void unlink_edge(MxVertexID v, MxQSlimEdge *e);
+    void relink_edge(MxQSlimEdge *e, MxVertexID from, MxVertexID to);
+
 protected:
     real check_local_compactness(uint v1, uint v2, const float *vnew);
     real check_local_inversion(uint v1, uint v2, const float *vnew);
@@ -67,14 +91,23 @@ protected:
     void create_edge(MxVertexID i, MxVertexID j);
     void collect_edges();
 
+    template<int placement, int weighting>
     void compute_target_placement(MxQSlimEdge *);
+    template<int penalties>
     void finalize_edge_update(MxQSlimEdge *);
 
-    virtual void compute_edge_info(MxQSlimEdge *);
-    virtual void update_pre_contract(const MxPairContraction&);
-    virtual void update_post_contract(const MxPairContraction&);
-    virtual void update_pre_expand(const MxPairContraction&);
-    virtual void update_post_expand(const MxPairContraction&);
+    template<int placement, int weighting, int penalties>
+    void compute_edge_info_t(MxQSlimEdge *);
+    template<int placement, int weighting, int penalties>
+    void apply_contraction_t(const MxPairContraction&);
+    template<int placement, int weighting, int penalties>
+    bool decimate_t(uint target);
+
+    void compute_edge_info(MxQSlimEdge *);
+    void update_pre_contract(const MxPairContraction&);
+    void update_post_contract(const MxPairContraction&);
+    void update_pre_expand(const MxPairContraction&);
+    void update_post_expand(const MxPairContraction&);
 
 public:
     MxEdgeQSlim(MxStdModel&);
@@ -83,6 +116,7 @@ public:
     void initialize();
     void initialize(const MxEdge *edges, uint count);
     bool decimate(uint target);
+    size_t memory_usage();
 
     void apply_contraction(const MxPairContraction& conx);
     void apply_expansion(const MxPairContraction& conx);
@@ -94,6 +128,51 @@ public:
     void (*contraction_callback)(const MxPairContraction&, float);
 };
 
+//
+// Edge contraction on half-edge connectivity: one heap entry per edge,
+// no face lists, and the link condition instead of the meshing checks
+// to keep the surface manifold.  The model gets the positions and the
+// faces, but not its neighbor lists.
+//
+class MxHalfEdgeQSlim : public MxQSlim
+{
+private:
+    class edge_info : public MxHeapable
+    {
+    public:
+	MxHalfEdgeID h;       // a live half-edge of the edge
+	MxVertexID v1, v2;    // v2 is contracted into v1
+	float vnew[3];
+    };
+
+    MxHalfEdgeModel he;
+    MxBlock<edge_info *> edge_of;    // NULL for edges never contracted
+    MxDynBlock<MxHalfEdgeID> ring_edges;
+    bool manifold;
+
+protected:
+    uint check_local_validity(MxVertexID v, MxVertexID other, const float *vnew);
+    void apply_mesh_penalties(edge_info *);
+    template<int placement, int weighting, int penalties>
+    void compute_edge_info_t(edge_info *);
+    void compute_edge_info(edge_info *);
+    template<int placement, int weighting, int penalties>
+    void contract_t(edge_info *);
+    template<int placement, int weighting, int penalties>
+    bool decimate_t(uint target);
+
+public:
+    MxHalfEdgeQSlim(MxStdModel&);
+    virtual ~MxHalfEdgeQSlim();
+
+    void initialize();
+    bool decimate(uint target);
+    size_t memory_usage();
+
+    // false when initialize() found a mesh the half-edges cannot hold
+    bool is_manifold() const { return manifold; }
+};
+
 class MxFaceQSlim : public MxQSlim
 {
 private:
@@ -115,6 +194,7 @@ public:
 
     void initialize();
     bool decimate(uint target);
+    size_t memory_usage();
 };
 
 // MXQSLIM_INCLUDED
@@ -37,6 +37,21 @@ MxStdModel::~MxStdModel()
     for(uint i=0; i<face_links.length(); i++)  delete face_links[i];
 }
 
+size_t MxStdModel::memory_usage() const
+{
+    size_t bytes = MxBlockModel::memory_usage()
+	+ v_data.total_space()*sizeof(vertex_data)
+	+ f_data.total_space()*sizeof(face_data)
+	+ face_links.total_space()*sizeof(MxFaceList *);
+
+    for(uint i=0; i<face_links.length(); i++)
+	if( face_links(i) )
+	    bytes += sizeof(MxFaceList)
+		+ face_links(i)->total_space()*sizeof(unsigned int);
+
+    return bytes;
+}
+
 MxVertexID MxStdModel::alloc_vertex(float x, float y, float z)
 {
     MxVertexID id = MxBlockModel::alloc_vertex(x,y,z);
@@ -459,6 +474,23 @@ void MxStdModel::unlink_face(MxFaceID fid)
     SanityCheck( !varray_find(neighbors(f(2)), fid, &j) );
 }
 
+// Drop the faces that are dead, or no longer use v, from the links of v
+// in a single pass (instead of one search per face).
+void MxStdModel::prune_neighbors(MxVertexID v)
+{
+    MxFaceList& N = neighbors(v);
+    unsigned int i = 0;
+
+    while( i<N.length() )
+    {
+	const MxFace& f = face(N(i));
+	if( face_is_valid(N(i)) && (f(0)==v || f(1)==v || f(2)==v) )
+	    i++;
+	else
+	    N.remove(i);
+    }
+}
+
 void MxStdModel::remove_degeneracy(MxFaceList& faces)
 {
     for(unsigned int i=0; i<faces.length(); i++)
@@ -520,9 +552,16 @@ void MxStdModel::apply_contraction(const MxPairContraction& conx)
 
     uint i;
     //
-    // Remove dead faces
+    // Remove dead faces.  They all use v1 and v2, and the links of v2
+    // are dropped below, so they are only unlinked from v1 and from
+    // their third vertex.
     for(i=0; i<conx.dead_faces.length(); i++)
-	unlink_face(conx.dead_faces(i));
+    {
+	MxFaceID fid = conx.dead_faces(i);
+	face_mark_invalid(fid);
+	remove_neighbor(neighbors(v1), fid);
+	remove_neighbor(neighbors(face(fid).opposite_vertex(v1, v2)), fid);
+    }
 
     //
     // Update changed faces
@@ -558,7 +597,7 @@ void MxStdModel::apply_expansion(const MxPairExpansion& conx)
     mxv_sub(vertex(v2), vertex(v1), conx.dv2, 3);
     mxv_subfrom(vertex(v1), conx.dv1, 3);
 
-    uint i,j;
+    uint i;
     for(i=0; i<conx.dead_faces.length(); i++)
     {
 	MxFaceID fid = conx.dead_faces(i);
@@ -573,10 +612,9 @@ void MxStdModel::apply_expansion(const MxPairExpansion& conx)
 	MxFaceID fid = conx.delta_faces(i);
 	face(fid).remap_vertex(v1, v2);
 	neighbors(v2).add(fid);
-	bool found = varray_find(neighbors(v1), fid, &j);
-	SanityCheck( found );
-	neighbors(v1).remove(j);
     }
+    if( conx.delta_pivot<conx.delta_faces.length() )
+	prune_neighbors(v1);    // the faces moved to v2
 
     //
     // !!HACK: This is really only a temporary solution to the problem
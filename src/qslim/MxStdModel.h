@@ -50,6 +50,39 @@ public:
 
 typedef MxPairContraction MxPairExpansion;
 
+//
+// Sets of vertices that are emptied in constant time.  A vertex is in
+// set k (0 or 1) when its stamp holds the current generation and bit k,
+// so testing membership does not search a vertex list.
+//
+class MxVertexStamps
+{
+private:
+    MxBlock<uint> stamps;
+    uint generation;
+
+public:
+    MxVertexStamps(uint n) : stamps(n) { clear(); }
+
+    void clear()
+	{
+	    for(int i=0; i<stamps.length(); i++)  stamps(i) = 0;
+	    generation = 1;
+	}
+    void next() { if( ++generation == (1u<<30) ) clear(); }
+
+    void mark(MxVertexID v, uint set=0)
+	{
+	    uint& s = stamps(v);
+	    if( (s>>2) != generation )  s = generation<<2;
+	    s |= 1<<set;
+	}
+    bool is_marked(MxVertexID v, uint set=0) const
+	{ uint s = stamps(v);  return (s>>2)==generation && (s&(1<<set)); }
+
+    size_t memory_usage() const { return stamps.length()*sizeof(uint); }
+};
+
 // Masks for internal tag bits
 #define MX_VALID_FLAG 0x01
 #define MX_PROXY_FLAG 0x02
@@ -103,6 +136,8 @@ public:
     virtual ~MxStdModel();
     MxStdModel *clone();
 
+    size_t memory_usage() const;
+
     ////////////////////////////////////////////////////////////////////////
     //  Tagging and marking
     //
@@ -182,6 +217,7 @@ public:
     void split_face4(MxFaceID f, MxVertexID *newverts=NULL);
 
     void unlink_face(MxFaceID f);
+    void prune_neighbors(MxVertexID v);
 
     ////////////////////////////////////////////////////////////////////////
     // Contraction and related operations
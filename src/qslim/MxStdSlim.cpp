@@ -25,6 +25,20 @@ MxStdSlim::MxStdSlim(MxStdModel *m0)
     local_validity_threshold = 0.0;
     vertex_degree_limit = 24;
     will_join_only = false;
+    error_limit = HUGE_VAL;
+    achieved_error = 0.0;
+    error_sum2 = 0.0;
+    contraction_count = 0;
+    time_quadrics = time_boundaries = time_edges = 0.0;
+    heap_extracts = stale_extracts = rejected_extracts = 0;
+    recomputations = optimize_fallbacks = 0;
+    progress_callback = NULL;
+    progress_data = NULL;
+    progress_interval = 1;
+    deadline = 0.0;
+    contraction_limit = 0;
+    stopped = false;
+    vertex_lock = NULL;
 
     valid_faces = 0;
     valid_verts = 0;
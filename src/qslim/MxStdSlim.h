@@ -17,6 +17,7 @@
 
 #include "MxStdModel.h"
 #include "MxHeap.h"
+#include "../gsalt_timer.h"
 
 #define MX_PLACE_ENDPOINTS 0
 #define MX_PLACE_ENDORMID  1
@@ -30,6 +31,9 @@
 #define MX_WEIGHT_AREA_AVG      4
 #define MX_WEIGHT_RAWNORMALS    5
 
+// Policy template argument: read the member at run time instead
+#define MX_POLICY_RUNTIME      -1
+
 class MxStdSlim
 {
 protected:
@@ -51,13 +55,65 @@ public:
     real local_validity_threshold;
     uint vertex_degree_limit;
 
+    real error_limit;          // decimate() stops before a contraction above
+    real achieved_error;       // highest cost of the contractions performed
+    real error_sum2;           // sum of their squared costs (for the RMS)
+    uint contraction_count;
+
+    double time_quadrics;      // initialize() sub-steps, in seconds
+    double time_boundaries;
+    double time_edges;         // building the heap of candidates
+    uint heap_extracts;
+    uint stale_extracts;       // candidate whose vertices (or face) are gone
+    uint rejected_extracts;    // contraction refused (will_join_only)
+    uint recomputations;       // cost of a queued candidate updated
+    uint optimize_fallbacks;   // optimal placement failed, used endpoints
+
+    // Called by decimate() every progress_interval contractions, giving
+    // back false stops it.  So does passing the deadline (a gsalt_time()
+    // value, 0 for none), looked at every 64 contractions, or reaching
+    // contraction_limit (0 for none).  decimate() can be called again
+    // after clearing stopped, it goes on from where it was.
+    bool (*progress_callback)(MxStdSlim *, void *);
+    void *progress_data;
+    uint progress_interval;
+    double deadline;
+    uint contraction_limit;
+    bool stopped;              // by the callback or a limit
+
+    // Vertex with a non zero entry are never moved nor removed (NULL: none),
+    // their neighbours can still be contracted onto them
+    const unsigned char *vertex_lock;
+
 public:
     MxStdSlim(MxStdModel *m0);
+    virtual ~MxStdSlim() { }
 
     virtual void initialize() = 0;
     virtual bool decimate(uint) = 0;
 
     MxStdModel& model() { return *m; }
+    bool vertex_is_locked(MxVertexID v) const { return vertex_lock && vertex_lock[v]; }
+    // Costs are squared distances, times an area if the quadrics are area weighted
+    virtual bool area_weighted() const { return false; }
+    virtual size_t memory_usage() { return m->memory_usage() + heap.memory_usage(); }
+
+    bool error_limit_reached()
+	{ MxHeapable *top = heap.top(); return top && -top->heap_key() > error_limit; }
+    void record_contraction(real err)
+	{
+	    if( err > achieved_error ) achieved_error = err;
+	    error_sum2 += err*err;
+	    contraction_count++;
+	    if( progress_callback && contraction_count%progress_interval==0 &&
+		!(*progress_callback)(this, progress_data) )
+		stopped = true;
+	    if( deadline>0.0 && (contraction_count&63)==0 &&
+		gsalt_time()>deadline )
+		stopped = true;
+	    if( contraction_count==contraction_limit )
+		stopped = true;
+	}
 };
 
 // MXSTDSLIM_INCLUDED
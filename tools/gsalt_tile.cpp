@@ -0,0 +1,77 @@
+// gsalt_tile: tiled simplification, one subcommand per step so a job runner can spread the tiles
+// over several processes or machines sharing the directory.
+//
+// usage: gsalt_tile split input dir [tiles]                  tiles per axis (default 4), prints the number of tiles
+//        gsalt_tile simplify dir tile objective [strategy]    tile is 0..number of tiles-1
+//        gsalt_tile stitch dir output objective [strategy]    the format comes from the extension (.ply, .stl, .obj)
+//   strategy    prop, edge, face or he (half-edge) (default prop), the same for every step
+//   objective   triangles of the whole mesh, the same for every step
+//
+// for example, on one machine:
+//   n=$(gsalt_tile split city.ply work 8)
+//   seq 0 $((n-1)) | xargs -P 8 -I{} gsalt_tile simplify work {} 100000 edge
+//   gsalt_tile stitch work city_low.ply 100000 edge
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gsalt/gsalt.h>
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s split input dir [tiles]\n", name);
+	fprintf(stderr, "       %s simplify dir tile objective [prop|edge|face|he]\n", name);
+	fprintf(stderr, "       %s stitch dir output objective [prop|edge|face|he]\n", name);
+}
+
+static int strategy(const char *s, unsigned int *flags)
+{
+	if (!s || !strcmp(s, "prop")) *flags = GSALT_PROP;
+	else if (!strcmp(s, "edge")) *flags = GSALT_EDGE;
+	else if (!strcmp(s, "face")) *flags = GSALT_FACE;
+	else if (!strcmp(s, "he")) *flags = GSALT_HALFEDGE;
+	else return 0;
+	return 1;
+}
+
+static int format_of(const char *filename)
+{
+	const char *ext = strrchr(filename, '.');
+	if (ext && (!strcmp(ext, ".stl") || !strcmp(ext, ".STL")))
+		return GSALT_FILE_STL;
+	if (ext && (!strcmp(ext, ".obj") || !strcmp(ext, ".OBJ")))
+		return GSALT_FILE_OBJ;
+	return GSALT_FILE_PLY;
+}
+
+// stdout only gets the results, for the scripts
+static void log_stderr(gsalt_verbose, const char *message, void *)
+{
+	fputs(message, stderr);
+}
+
+int main(int argc, char** argv) {
+	if (argc<2) {
+		usage(argv[0]);
+		return 1;
+	}
+	gsalt_set_log_callback(log_stderr, NULL);
+	gsalt_init();
+	unsigned int flags = GSALT_PROP;
+	int ret = -1;
+	if (!strcmp(argv[1], "split") && (argc==4 || argc==5)) {
+		ret = gsalt_tile_split(argv[2], argv[3], (argc==5)?atoi(argv[4]):4);
+	} else if (!strcmp(argv[1], "simplify") && (argc==5 || argc==6) && strategy((argc==6)?argv[5]:NULL, &flags)) {
+		ret = gsalt_tile_simplify(argv[2], atoi(argv[3]), atoi(argv[4]), flags);
+	} else if (!strcmp(argv[1], "stitch") && (argc==5 || argc==6) && strategy((argc==6)?argv[5]:NULL, &flags)) {
+		ret = gsalt_tile_stitch(argv[2], argv[3], format_of(argv[3]), atoi(argv[4]), flags);
+	} else {
+		usage(argv[0]);
+		return 1;
+	}
+	gsalt_flush_log();
+	if (ret<0)
+		return 1;
+	printf("%d\n", ret);
+	return 0;
+}